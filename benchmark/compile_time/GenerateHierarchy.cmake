@@ -0,0 +1,129 @@
+# Generates a synthetic class hierarchy exposed through CXXFFI_EXPOSE, for measuring
+# how compile time scales with the size and shape of an API.
+#
+# Copyright: Geopipe, Inc.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Advance the linear congruential generator in VAR, leaving a value in [0, 2^31).
+macro(_cxxffi_next_random VAR)
+	math(EXPR ${VAR} "(${${VAR}} * 1103515245 + 12345) % 2147483648")
+endmacro()
+
+# cxxffi_generate_hierarchy(<output .cc> CLASSES <n> DEPTH <d> FANOUT <f> DIAMONDS <percent> FUNCTIONS <k> [SEED <s>] [NONVIRTUAL])
+#
+# Writes a translation unit declaring CLASSES classes arranged in DEPTH + 1 levels.
+# Each class below the first level virtually inherits one class from the level
+# above, and with probability DIAMONDS percent, up to FANOUT - 1 more, so that
+# hierarchies converge into diamonds. (Inheritance is virtual, since non-virtual
+# diamonds make bases ambiguous.) With NONVIRTUAL, which requires DIAMONDS 0, the
+# classes instead form single, non-virtual inheritance trees, and each has a data
+# member, so derived classes grow with depth. FUNCTIONS API functions taking and
+# returning the classes, alternately by reference and by std::shared_ptr, are then
+# exposed via CXXFFI_EXPOSE. The output depends only on the arguments.
+function(cxxffi_generate_hierarchy OUTPUT)
+	cmake_parse_arguments(GEN "NONVIRTUAL" "CLASSES;DEPTH;FANOUT;DIAMONDS;FUNCTIONS;SEED" "" ${ARGN})
+	if(NOT DEFINED GEN_SEED)
+		set(GEN_SEED 1)
+	endif()
+	math(EXPR levels "${GEN_DEPTH} + 1")
+	if(GEN_CLASSES LESS levels)
+		message(FATAL_ERROR "cxxffi_generate_hierarchy needs at least DEPTH + 1 classes")
+	endif()
+	if(GEN_NONVIRTUAL AND NOT GEN_DIAMONDS EQUAL 0)
+		message(FATAL_ERROR "cxxffi_generate_hierarchy with NONVIRTUAL needs DIAMONDS 0")
+	endif()
+	set(virtual "virtual ")
+	set(member "")
+	set(mode "")
+	if(GEN_NONVIRTUAL)
+		set(virtual "")
+		set(mode " NONVIRTUAL")
+	endif()
+	set(random ${GEN_SEED})
+
+	set(out "// Generated by cxxffi_generate_hierarchy(CLASSES ${GEN_CLASSES} DEPTH ${GEN_DEPTH} FANOUT ${GEN_FANOUT} DIAMONDS ${GEN_DIAMONDS} FUNCTIONS ${GEN_FUNCTIONS} SEED ${GEN_SEED}${mode}). Do not edit.\n")
+	string(APPEND out "#include <cxx-ffi/casts_table.hpp>\n#include <boost/dll/runtime_symbol_info.hpp>\n\n")
+	string(APPEND out "static boost::filesystem::path generatedLoc() {\n\treturn boost::dll::this_line_location();\n}\n\n")
+
+	# Class i is on level i % levels, so every level is populated and earlier classes are always declared first.
+	set(roots "")
+	math(EXPR last "${GEN_CLASSES} - 1")
+	foreach(i RANGE ${last})
+		math(EXPR level "${i} % ${levels}")
+		if(GEN_NONVIRTUAL)
+			set(member "\tint m${i} = 0;\n")
+		endif()
+		if(level EQUAL 0)
+			string(APPEND out "struct C${i} {\n\tvirtual ~C${i}() = default;\n${member}};\n\n")
+			list(APPEND roots ${i})
+			continue()
+		endif()
+		# Candidates are the already-declared classes on the level above.
+		math(EXPR above "${level} - 1")
+		math(EXPR candidateCount "(${i} - ${above} + ${levels} - 1) / ${levels}")
+		_cxxffi_next_random(random)
+		math(EXPR pick "${random} % ${candidateCount}")
+		math(EXPR base "${pick} * ${levels} + ${above}")
+		set(bases ${base})
+		_cxxffi_next_random(random)
+		math(EXPR roll "${random} % 100")
+		if(roll LESS GEN_DIAMONDS AND GEN_FANOUT GREATER 1)
+			math(EXPR extra "${GEN_FANOUT} - 1")
+			foreach(j RANGE 1 ${extra})
+				_cxxffi_next_random(random)
+				math(EXPR pick "${random} % ${candidateCount}")
+				math(EXPR base "${pick} * ${levels} + ${above}")
+				list(FIND bases ${base} found)
+				if(found EQUAL -1)
+					list(APPEND bases ${base})
+				endif()
+			endforeach()
+		endif()
+		set(inherit "")
+		set(reflect "")
+		foreach(base IN LISTS bases)
+			list(APPEND inherit "${virtual}C${base}")
+			list(APPEND reflect "C${base}")
+		endforeach()
+		string(REPLACE ";" ", " inherit "${inherit}")
+		string(REPLACE ";" ", " reflect "${reflect}")
+		string(APPEND out "struct C${i} : ${inherit} {\n\tusing ReflBases = CxxFFI::DefineBases<${reflect}>;\n${member}};\n\n")
+	endforeach()
+
+	string(APPEND out "namespace CxxFFI {\n")
+	foreach(root IN LISTS roots)
+		string(APPEND out "\ttemplate<> struct APIFilter<C${root}> {\n\t\tusing type = boost::mpl::bool_<true>;\n\t};\n")
+	endforeach()
+	string(APPEND out "}\n\n")
+
+	set(functions "")
+	math(EXPR lastFunction "${GEN_FUNCTIONS} - 1")
+	foreach(k RANGE ${lastFunction})
+		_cxxffi_next_random(random)
+		math(EXPR from "${random} % ${GEN_CLASSES}")
+		_cxxffi_next_random(random)
+		math(EXPR to "${random} % ${GEN_CLASSES}")
+		math(EXPR shared "${k} % 2")
+		if(shared)
+			string(APPEND out "std::shared_ptr<C${to}> f${k}(std::shared_ptr<C${from}>) {\n\treturn nullptr;\n}\n\n")
+		else()
+			string(APPEND out "C${to}* f${k}(C${from}&) {\n\treturn nullptr;\n}\n\n")
+		endif()
+		string(APPEND functions "(f${k})")
+	endforeach()
+	string(APPEND out "CXXFFI_EXPOSE(generatedCastsTable, generatedLoc, ${functions});\n")
+
+	file(WRITE "${OUTPUT}" "${out}")
+endfunction()
@@ -0,0 +1,72 @@
+/************************************************************************************
+ * @file measure.cc
+ * Runs a command, and reports its wall time and peak resident set size, for the
+ * compile-time scaling benchmark (see `run.cmake`). CMake can't measure either
+ * portably, and `/usr/bin/time` isn't always installed.
+ *
+ * The command's stdout and stderr are passed through unchanged; the measurements
+ * are written to the file named by the first argument as a single JSON object with
+ * the fields `exit`, `wall_ms`, and `max_rss_kb`.
+ *
+ * Usage: `bench-measure-command <output.json> <command> [arguments...]`.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+
+int main(int argc, char *argv[]) {
+	if(argc < 3) {
+		std::fprintf(stderr, "Usage: %s <output.json> <command> [arguments...]\n", argv[0]);
+		return 2;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	pid_t pid = fork();
+	if(pid < 0) {
+		std::perror("fork");
+		return 2;
+	} else if(pid == 0) {
+		execvp(argv[2], argv + 2);
+		std::perror(argv[2]);
+		_exit(127);
+	}
+
+	int status = 0;
+	struct rusage usage = {};
+	if(wait4(pid, &status, 0, &usage) != pid) {
+		std::perror("wait4");
+		return 2;
+	}
+	double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+	std::FILE *out = std::fopen(argv[1], "w");
+	if(!out) {
+		std::perror(argv[1]);
+		return 2;
+	}
+	// `ru_maxrss` is in kilobytes on Linux.
+	std::fprintf(out, "{\"exit\":%d,\"wall_ms\":%.1f,\"max_rss_kb\":%ld}\n", exitCode, wallMs, usage.ru_maxrss);
+	std::fclose(out);
+	return exitCode;
+}
@@ -0,0 +1,132 @@
+# Compile-time scaling benchmark: generates synthetic hierarchies of increasing size
+# with GenerateHierarchy.cmake, compiles each one, and appends a JSON object per
+# configuration to results.jsonl in WORK_DIR, with the fields `classes`, `depth`,
+# `fanout`, `diamonds`, `functions`, `exit`, `wall_ms`, `max_rss_kb`,
+# `object_bytes`, and `phases` (milliseconds per compiler phase).
+#
+# Run via the bench-compile-time target, or directly as
+#   cmake -DCXX=... -DCXX_ID=GNU|Clang -DMEASURE=.../bench-measure-command
+#         -DWORK_DIR=... [-DINCLUDES=dir:dir] [-DFLAGS="-O2 ..."]
+#         [-DCONFIGS=classes:depth:fanout:diamonds:functions,...] -P run.cmake
+#
+# Phases come from -ftime-trace under Clang (its "Total ..." events), and from
+# -ftime-report under GCC (its "phase ..." lines, plus template instantiation and
+# name lookup), since GCC has no -ftime-trace. Under Clang the full trace of each
+# configuration is kept alongside its object for inspection in a trace viewer.
+#
+# Copyright: Geopipe, Inc.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+cmake_minimum_required(VERSION 3.15.0)
+include(${CMAKE_CURRENT_LIST_DIR}/GenerateHierarchy.cmake)
+
+foreach(required CXX MEASURE WORK_DIR)
+	if(NOT DEFINED ${required})
+		message(FATAL_ERROR "run.cmake requires -D${required}=...")
+	endif()
+endforeach()
+if(NOT DEFINED CONFIGS)
+	set(CONFIGS "25:3:2:20:10,50:4:2:20:20,100:5:3:20:40,150:6:3:20:60")
+endif()
+if(NOT DEFINED FLAGS)
+	set(FLAGS "-O2")
+endif()
+string(REPLACE "," ";" CONFIGS "${CONFIGS}")
+separate_arguments(FLAGS UNIX_COMMAND "${FLAGS}")
+get_filename_component(repoInclude "${CMAKE_CURRENT_LIST_DIR}/../../include" ABSOLUTE)
+set(includeFlags "-I${repoInclude}")
+if(INCLUDES)
+	string(REPLACE ":" ";" INCLUDES "${INCLUDES}")
+	foreach(dir IN LISTS INCLUDES)
+		list(APPEND includeFlags "-I${dir}")
+	endforeach()
+endif()
+if(CXX_ID MATCHES "Clang")
+	set(traceFlag -ftime-trace)
+else()
+	set(traceFlag -ftime-report)
+endif()
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+set(results "${WORK_DIR}/results.jsonl")
+file(WRITE "${results}" "")
+
+foreach(config IN LISTS CONFIGS)
+	string(REPLACE ":" ";" fields "${config}")
+	list(LENGTH fields fieldCount)
+	if(NOT fieldCount EQUAL 5)
+		message(FATAL_ERROR "Malformed configuration '${config}', expected classes:depth:fanout:diamonds:functions")
+	endif()
+	list(GET fields 0 classes)
+	list(GET fields 1 depth)
+	list(GET fields 2 fanout)
+	list(GET fields 3 diamonds)
+	list(GET fields 4 functions)
+	set(stem "${WORK_DIR}/hierarchy-${classes}-${depth}-${fanout}-${diamonds}-${functions}")
+	cxxffi_generate_hierarchy("${stem}.cc" CLASSES ${classes} DEPTH ${depth} FANOUT ${fanout} DIAMONDS ${diamonds} FUNCTIONS ${functions})
+
+	message(STATUS "Compiling ${classes} classes, depth ${depth}, fan-out ${fanout}, ${diamonds}% diamonds, ${functions} functions")
+	execute_process(
+		COMMAND "${MEASURE}" "${stem}.measure.json" "${CXX}" -std=c++17 -fPIC ${FLAGS} ${includeFlags} ${traceFlag} -c "${stem}.cc" -o "${stem}.o"
+		RESULT_VARIABLE exitCode
+		ERROR_VARIABLE report)
+	file(READ "${stem}.measure.json" measured)
+	string(STRIP "${measured}" measured)
+
+	set(objectBytes 0)
+	if(exitCode EQUAL 0)
+		file(SIZE "${stem}.o" objectBytes)
+	else()
+		message(WARNING "Compilation failed with exit code ${exitCode}:\n${report}")
+	endif()
+
+	set(phases "")
+	if(CXX_ID MATCHES "Clang")
+		if(EXISTS "${stem}.json")
+			file(READ "${stem}.json" trace)
+			string(REGEX MATCHALL "\"dur\":[0-9]+,\"name\":\"Total [^\"]+\"" totals "${trace}")
+			foreach(total IN LISTS totals)
+				string(REGEX REPLACE "\"dur\":([0-9]+),\"name\":\"Total ([^\"]+)\"" "\\1;\\2" parts "${total}")
+				list(GET parts 0 us)
+				list(GET parts 1 name)
+				math(EXPR ms "${us} / 1000")
+				list(APPEND phases "\"${name}\":${ms}")
+			endforeach()
+		endif()
+	else()
+		# Lines look like " phase parsing    :   1.49 ( 39%)   0.74 ( 62%)   2.27 ( 44%)   153M ( 48%)", with user, system, and wall seconds.
+		string(REPLACE "\n" ";" lines "${report}")
+		foreach(line IN LISTS lines)
+			if(line MATCHES "^ (phase [^:]*[^ :]|template instantiation|name lookup) *:[^)]*\\)[^)]*\\) +([0-9.]+)")
+				set(name "${CMAKE_MATCH_1}")
+				string(REPLACE "." "" ms "${CMAKE_MATCH_2}")
+				math(EXPR ms "${ms} * 10")
+				list(APPEND phases "\"${name}\":${ms}")
+			elseif(line MATCHES "^ (TOTAL) *: +[0-9.]+ +[0-9.]+ +([0-9.]+)")
+				string(REPLACE "." "" ms "${CMAKE_MATCH_2}")
+				math(EXPR ms "${ms} * 10")
+				list(APPEND phases "\"TOTAL\":${ms}")
+			endif()
+		endforeach()
+	endif()
+	string(REPLACE ";" "," phases "${phases}")
+
+	# Splice the configuration and the remaining measurements into the object written by bench-measure-command.
+	string(REGEX REPLACE "^{" "{\"classes\":${classes},\"depth\":${depth},\"fanout\":${fanout},\"diamonds\":${diamonds},\"functions\":${functions}," line "${measured}")
+	string(REGEX REPLACE "}$" ",\"object_bytes\":${objectBytes},\"phases\":{${phases}}}" line "${line}")
+	file(APPEND "${results}" "${line}\n")
+	message(STATUS "${line}")
+endforeach()
+message(STATUS "Results written to ${results}")
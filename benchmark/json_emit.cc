@@ -0,0 +1,202 @@
+/************************************************************************************
+ * @file json_emit.cc
+ * Compares the cost of emitting a large JSON casts table through `std::ostringstream`,
+ * `std::quoted`, and inserting map lookups (the original approach) against the
+ * two-pass, single-allocation `CxxFFI::detail::emitCastsTable`, reporting the time,
+ * number of allocations, bytes allocated, and peak heap growth of each.
+ *
+ * Usage: `bench-json-emit [type count] [upcasts per type]`, defaulting to 2048
+ * types with 16 upcasts each.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <cxx-ffi/casts_table.hpp>
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Heap usage, tallied by the replacement `operator new` and `operator delete` below.
+namespace heap {
+	std::size_t allocations = 0, allocated = 0, live = 0, peak = 0;
+
+	/// Forget everything but the current live bytes.
+	void reset() {
+		allocations = allocated = 0;
+		peak = live;
+	}
+}
+
+void* operator new(std::size_t size) {
+	void *p = std::malloc(size ? size : 1);
+	if(!p) {
+		throw std::bad_alloc();
+	}
+	std::size_t usable = malloc_usable_size(p);
+	++heap::allocations;
+	heap::allocated += usable;
+	heap::live += usable;
+	heap::peak = std::max(heap::peak, heap::live);
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	if(p) {
+		heap::live -= malloc_usable_size(p);
+		std::free(p);
+	}
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+	operator delete(p);
+}
+
+/// The most types `syntheticDescription` can describe, since each needs its own name function.
+constexpr std::size_t maxTypes = 4096;
+
+/// The names of the synthetic types.
+std::vector<std::string>& syntheticNames() {
+	static std::vector<std::string> ans;
+	return ans;
+}
+
+/// Obtain the name of the `I`th synthetic type, in the form `UpcastDescriptor` and `TypeDescriptor` require.
+template<std::size_t I> const std::string& syntheticName() {
+	return syntheticNames()[I];
+}
+
+/// A name function for each synthetic type.
+template<std::size_t ...Is> constexpr std::array<const std::string& (*)(), sizeof...(Is)> nameFunctions(std::index_sequence<Is...>) {
+	return {&syntheticName<Is>...};
+}
+
+/// Describe `types` types, each with upcasts to `upcasts` of the types before it, with a symbol for each upcast in `symbols`.
+CxxFFI::detail::HierarchyDescription syntheticDescription(std::size_t types, std::size_t upcasts, std::vector<std::string>& symbols) {
+	static constexpr auto names = nameFunctions(std::make_index_sequence<maxTypes>());
+	for(std::size_t i = 0; i < types; ++i) {
+		syntheticNames().push_back("geo::api::Layer" + std::to_string(i % 7) + "::Node<geo::api::Kind" + std::to_string(i) + ", std::allocator<char> >");
+	}
+	CxxFFI::detail::HierarchyDescription description;
+	for(std::size_t i = 0; i < types; ++i) {
+		std::size_t count = std::min(i, upcasts);
+		description.types.push_back({&typeid(void), names[i], names[i], 8, 8, nullptr, &typeid(void), false, false, count});
+		for(std::size_t j = 0; j < count; ++j) {
+			std::size_t base = (i * 31 + j * 17) % i;
+			description.upcasts.push_back({&typeid(void), &typeid(void), names[i], names[base], names[base], nullptr, nullptr, nullptr, nullptr, false, false, false, false, 0});
+			symbols.push_back("_ZN6CxxFFI6upcastIN3geo3api4NodeILi" + std::to_string(i) + "EEENS3_ILi" + std::to_string(base) + "EEEEPT0_PT_");
+		}
+	}
+	return description;
+}
+
+/// A runtime transcription of the original recursive `operator<<` functors, with the same streams, quoting, and map accesses.
+std::string legacyJson(const CxxFFI::detail::HierarchyDescription& description, std::map<std::string, std::map<std::string, std::string> >& knownCasts) {
+	std::ostringstream o;
+	o << "{";
+	const CxxFFI::detail::UpcastDescriptor *upcast = description.upcasts.data();
+	for(std::size_t i = 0; i < description.types.size(); ++i) {
+		const CxxFFI::detail::TypeDescriptor& type = description.types[i];
+		std::map<std::string, std::string>& casts = knownCasts[type.name()];
+		o << "\n\t" << "" << std::quoted(type.apiName()) << " : {";
+		const CxxFFI::detail::UpcastDescriptor *end = upcast + type.upcastCount;
+		for(; upcast != end; ++upcast) {
+			const std::string& castSymbol = casts[upcast->baseName()];
+			if(castSymbol.length()) {
+				o << "\n\t\t" << std::quoted(upcast->baseApiName()) << " : " << std::quoted(castSymbol) << (upcast + 1 != end ? ", " : "");
+			}
+		}
+		o << "}" << (i + 1 != description.types.size() ? ", " : "");
+	}
+	o << "}";
+	return o.str();
+}
+
+/// Measurements of one emitter.
+struct Result {
+	std::string json;
+	double ms = 0;
+	std::size_t allocations = 0, allocated = 0, peak = 0;
+};
+
+/// Run `emit(prepare())` `reps` times, keeping the fastest time, and the heap usage of the last run. Only `emit` is measured.
+template<typename Prepare, typename Emit> Result measure(int reps, Prepare prepare, Emit emit) {
+	Result ans;
+	ans.ms = 1e300;
+	for(int rep = 0; rep < reps; ++rep) {
+		ans.json.clear();
+		ans.json.shrink_to_fit();
+		auto state = prepare();
+		std::size_t baseline = heap::live;
+		heap::reset();
+		auto start = std::chrono::steady_clock::now();
+		ans.json = emit(state);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		ans.ms = std::min(ans.ms, elapsed.count());
+		ans.allocations = heap::allocations;
+		ans.allocated = heap::allocated;
+		ans.peak = heap::peak - baseline;
+	}
+	return ans;
+}
+
+int main(int argc, const char *argv[]) {
+	std::size_t types = std::min<std::size_t>(argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2048, maxTypes);
+	std::size_t upcasts = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 16;
+	std::vector<std::string> symbols;
+	CxxFFI::detail::HierarchyDescription description = syntheticDescription(types, upcasts, symbols);
+	std::map<std::string, std::map<std::string, std::string> > knownCasts;
+	for(std::size_t i = 0; i < description.upcasts.size(); ++i) {
+		knownCasts[description.upcasts[i].derivedName()][description.upcasts[i].baseName()] = symbols[i];
+	}
+	const int reps = 5;
+
+	// The legacy emitter inserts into `knownCasts`, so give it a fresh copy each time.
+	Result legacy = measure(reps, [&]() {
+		return knownCasts;
+	}, [&](std::map<std::string, std::map<std::string, std::string> >& casts) {
+		return legacyJson(description, casts);
+	});
+	// Look symbols up without inserting, as `CastsTable::upcastSymbol` does.
+	Result writer = measure(reps, []() {
+		return nullptr;
+	}, [&](std::nullptr_t) {
+		auto symbolOf = [&](const CxxFFI::detail::UpcastDescriptor& upcast) -> const std::string& {
+			return knownCasts.find(upcast.derivedName())->second.find(upcast.baseName())->second;
+		};
+		return CxxFFI::detail::writeJson([&](auto& sink) {
+			CxxFFI::detail::emitCastsTable(sink, description, symbolOf);
+		});
+	});
+
+	std::cout << "types=" << types << " upcasts=" << description.upcasts.size() << " json_bytes=" << writer.json.size()
+	          << " legacy_ms=" << legacy.ms << " legacy_allocations=" << legacy.allocations << " legacy_allocated_bytes=" << legacy.allocated << " legacy_peak_bytes=" << legacy.peak
+	          << " writer_ms=" << writer.ms << " writer_allocations=" << writer.allocations << " writer_allocated_bytes=" << writer.allocated << " writer_peak_bytes=" << writer.peak
+	          << " speedup=" << legacy.ms / writer.ms << std::endl;
+	return legacy.json == writer.json ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/************************************************************************************
+ * @file parallel_scan.cc
+ * Measures how `CxxFFI::detail::scanUpcastSymbols` scales from one thread up to
+ * the hardware concurrency, and checks that every thread count produces the same
+ * matches as the serial scan.
+ *
+ * Usage: `bench-parallel-scan [symbol count] [max threads]`, defaulting to
+ * 2000000 symbols and `std::thread::hardware_concurrency()` threads.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include "synthetic_symbols.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/// Whether `a` and `b` contain the same matches in the same order.
+bool sameMatches(const std::vector<CxxFFI::detail::UpcastSymbolMatch>& a, const std::vector<CxxFFI::detail::UpcastSymbolMatch>& b) {
+	return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const auto& l, const auto& r) {
+		return l.symbol == r.symbol && l.derived == r.derived && l.base == r.base;
+	});
+}
+
+int main(int argc, const char *argv[]) {
+	std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+	unsigned maxThreads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+	constexpr int repetitions = 5;
+
+	std::vector<std::string> symbols = syntheticSymbols(count);
+	CxxFFI::detail::UpcastSymbolMatcher matcher;
+	addKnownTypes(matcher, KnownTypes());
+	std::vector<CxxFFI::detail::UpcastSymbolMatch> serial = CxxFFI::detail::scanUpcastSymbols(matcher, symbols, 1);
+
+	double baseline = 0;
+	bool allIdentical = true;
+	for(unsigned threads = 1; threads <= maxThreads; ++threads) {
+		std::vector<double> times;
+		bool identical = true;
+		for(int i = 0; i < repetitions; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			// A chunk size of 1 forces exactly `threads` workers, even for small tables.
+			std::vector<CxxFFI::detail::UpcastSymbolMatch> matches = CxxFFI::detail::scanUpcastSymbols(matcher, symbols, threads, 1);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			times.push_back(elapsed.count());
+			identical = identical && sameMatches(matches, serial);
+		}
+		std::sort(times.begin(), times.end());
+		double median = times[repetitions / 2];
+		if(threads == 1) {
+			baseline = median;
+		}
+		allIdentical = allIdentical && identical;
+		std::cout << "symbols=" << count << " threads=" << threads << " median_ms=" << median
+		          << " speedup=" << baseline / median << " matches=" << serial.size() << " identical=" << identical << std::endl;
+	}
+	return allIdentical ? 0 : 1;
+}
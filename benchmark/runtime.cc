@@ -0,0 +1,331 @@
+/************************************************************************************
+ * @file runtime.cc
+ * Measures, from the point of view of an FFI consumer which `dlopen`s the example
+ * library: the latency and throughput of upcasts for raw pointers and
+ * `std::shared_ptr` handles across single, virtual, and diamond inheritance; the
+ * cold and warm cost of the generated casts table functions, whole and per type;
+ * and the cost of looking up upcasts by name versus by type id.
+ *
+ * Every result is written to stdout as one JSON object per line, with the fields
+ * `benchmark`, `case`, `ns` (per operation), and `ops_per_sec`, so that runs can be
+ * compared mechanically.
+ *
+ * Usage: `bench-runtime [path to libtestlib]`.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include "../example/test-lib.hpp"
+
+#include <cxx-ffi/binary_table.hpp>
+#include <cxx-ffi/casts_stats.hpp>
+
+#include <dlfcn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	/// Signatures of the functions generated by `CXXFFI_EXPOSE(castsTable, ...)`.
+	using TableFunc = const char*(*)();
+	using BinaryFunc = const void*(*)();
+	using TypeIdFunc = std::uint32_t(*)(const char*);
+	using FindUpcastFunc = void(*(*)(std::uint32_t, std::uint32_t))();
+	using IsSubtypeFunc = int(*)(std::uint32_t, std::uint32_t);
+	using TypeCastsFunc = const char*(*)(const char*);
+
+	/// Iterations per timed loop.
+	constexpr std::size_t iterations = 1 << 20;
+	/// Elements per call to a batched upcast.
+	constexpr std::size_t batchSize = 1024;
+
+	/// Print one result as a line of JSON.
+	void report(const char *benchmark, const std::string &name, double ns) {
+		std::printf("{\"benchmark\": \"%s\", \"case\": \"%s\", \"ns\": %.3f, \"ops_per_sec\": %.1f}\n", benchmark, name.c_str(), ns, ns > 0 ? 1e9 / ns : 0.0);
+		std::fflush(stdout);
+	}
+
+	/// Time `n` invocations of `f`, returning nanoseconds per invocation.
+	template<typename F> double timePerOp(std::size_t n, F f) {
+		auto start = std::chrono::steady_clock::now();
+		for(std::size_t i = 0; i < n; ++i) {
+			f(i);
+		}
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+	}
+
+	/// Prevent the compiler from discarding `value`.
+	template<typename T> void keep(T value) {
+		asm volatile("" : : "g"(value) : "memory");
+	}
+
+	/// Resolve `symbol` in `library`, or exit.
+	template<typename F> F require(void *library, const char *symbol) {
+		void *fn = dlsym(library, symbol);
+		if(!fn) {
+			std::cerr << "Missing symbol " << symbol << ": " << dlerror() << std::endl;
+			std::exit(1);
+		}
+		return reinterpret_cast<F>(fn);
+	}
+
+	/// The cast record from type id `derived` to type id `base` in a binary casts table, or `nullptr`.
+	const CxxFFI::BinaryCastRecord* findCastRecord(const void *table, std::uint32_t derived, std::uint32_t base) {
+		const unsigned char *bytes = static_cast<const unsigned char*>(table);
+		const CxxFFI::BinaryTableHeader *header = static_cast<const CxxFFI::BinaryTableHeader*>(table);
+		const CxxFFI::BinaryTypeRecord *type = reinterpret_cast<const CxxFFI::BinaryTypeRecord*>(bytes + header->typesOffset + derived * header->typeRecordSize);
+		for(std::uint32_t i = type->firstCast; i < type->firstCast + type->castCount; ++i) {
+			const CxxFFI::BinaryCastRecord *cast = reinterpret_cast<const CxxFFI::BinaryCastRecord*>(bytes + header->castsOffset + i * header->castRecordSize);
+			if(cast->base == base) {
+				return cast;
+			}
+		}
+		return nullptr;
+	}
+
+	/// Everything needed to call the upcasts between one pair of types.
+	struct Casts {
+		void (*single)();
+		void (*batched)();
+		void (*inPlace)();
+	};
+
+	/// Look up the upcasts from `derived` to `base` by name, or exit.
+	Casts requireCasts(TypeIdFunc typeId, FindUpcastFunc findUpcast, const void *table, const char *derived, const char *base) {
+		std::uint32_t derivedId = typeId(derived), baseId = typeId(base);
+		const CxxFFI::BinaryCastRecord *record = findCastRecord(table, derivedId, baseId);
+		void (*single)() = findUpcast(derivedId, baseId);
+		if(!single || !record) {
+			std::cerr << "Missing upcast from " << derived << " to " << base << std::endl;
+			std::exit(1);
+		}
+		return {single, reinterpret_cast<void(*)()>(record->upcastN.fn), reinterpret_cast<void(*)()>(record->upcastInto.fn)};
+	}
+
+	/// Benchmark the raw pointer upcast `casts` from `Derived` to `Base`.
+	template<typename Derived, typename Base> void benchmarkRaw(const std::string &name, const Casts &casts) {
+		auto single = reinterpret_cast<Base*(*)(Derived*)>(casts.single);
+		auto batched = reinterpret_cast<void(*)(Derived* const*, Base**, std::size_t)>(casts.batched);
+		std::vector<Derived> objects(batchSize);
+		std::vector<Derived*> in(batchSize);
+		std::vector<Base*> out(batchSize);
+		for(std::size_t i = 0; i < batchSize; ++i) {
+			in[i] = &objects[i];
+		}
+		report("upcast", "raw " + name, timePerOp(iterations, [&](std::size_t i) {
+			keep(single(in[i % batchSize]));
+		}));
+		report("upcast_n", "raw " + name, timePerOp(iterations / batchSize, [&](std::size_t) {
+			batched(in.data(), out.data(), batchSize);
+			keep(out.data());
+		}) / batchSize);
+	}
+
+	/// Benchmark the `std::shared_ptr` upcast `casts` from `Derived` to `Base`, with heap-allocated and in-place results.
+	template<typename Derived, typename Base> void benchmarkShared(const std::string &name, const Casts &casts) {
+		using DerivedPtr = std::shared_ptr<Derived>;
+		using BasePtr = std::shared_ptr<Base>;
+		auto single = reinterpret_cast<BasePtr*(*)(DerivedPtr*)>(casts.single);
+		auto inPlace = reinterpret_cast<BasePtr*(*)(DerivedPtr*, void*)>(casts.inPlace);
+		auto batched = reinterpret_cast<void(*)(DerivedPtr* const*, BasePtr**, std::size_t)>(casts.batched);
+		std::vector<DerivedPtr> handles(batchSize);
+		std::vector<DerivedPtr*> in(batchSize);
+		std::vector<BasePtr*> out(batchSize);
+		for(std::size_t i = 0; i < batchSize; ++i) {
+			handles[i] = std::make_shared<Derived>();
+			in[i] = &handles[i];
+		}
+		report("upcast", "shared_ptr " + name, timePerOp(iterations, [&](std::size_t i) {
+			delete single(in[i % batchSize]);
+		}));
+		alignas(BasePtr) unsigned char storage[sizeof(BasePtr)];
+		report("upcast_into", "shared_ptr " + name, timePerOp(iterations, [&](std::size_t i) {
+			BasePtr *result = inPlace(in[i % batchSize], storage);
+			keep(result);
+			result->~BasePtr();
+		}));
+		report("upcast_n", "shared_ptr " + name, timePerOp(iterations / batchSize, [&](std::size_t) {
+			batched(in.data(), out.data(), batchSize);
+			for(BasePtr *result : out) {
+				delete result;
+			}
+		}) / batchSize);
+	}
+
+	/**************************************************
+	 * Benchmark the `boost::intrusive_ptr` upcast `casts`
+	 * from `Derived` to `Base`, which retypes its argument
+	 * in place rather than allocating. Since that consumes
+	 * the argument, each operation also constructs it and
+	 * destroys the result, costing a reference count
+	 * increment and decrement, as `upcast_into` does.
+	 **************************************************/
+	template<typename Derived, typename Base> void benchmarkIntrusive(const std::string &name, const Casts &casts) {
+		using DerivedPtr = boost::intrusive_ptr<Derived>;
+		using BasePtr = boost::intrusive_ptr<Base>;
+		auto single = reinterpret_cast<BasePtr*(*)(DerivedPtr*)>(casts.single);
+		auto inPlace = reinterpret_cast<BasePtr*(*)(DerivedPtr*, void*)>(casts.inPlace);
+		DerivedPtr handle(new Derived());
+		alignas(DerivedPtr) unsigned char argument[sizeof(DerivedPtr)];
+		report("upcast", "intrusive_ptr " + name, timePerOp(iterations, [&](std::size_t) {
+			BasePtr *result = single(new (argument) DerivedPtr(handle));
+			keep(result);
+			result->~BasePtr();
+		}));
+		alignas(BasePtr) unsigned char storage[sizeof(BasePtr)];
+		report("upcast_into", "intrusive_ptr " + name, timePerOp(iterations, [&](std::size_t) {
+			BasePtr *result = inPlace(&handle, storage);
+			keep(result);
+			result->~BasePtr();
+		}));
+	}
+
+	/// In a child process, `dlopen` the library and time the first and second calls of `call(library)`, writing both to `fd`.
+	template<typename Call> void measureCold(const char *path, Call call, std::chrono::milliseconds startup, int fd) {
+		double times[3];
+		auto start = std::chrono::steady_clock::now();
+		void *library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+		auto opened = std::chrono::steady_clock::now();
+		if(startup.count()) {
+			std::this_thread::sleep_for(startup);
+			opened = std::chrono::steady_clock::now();
+		}
+		call(library);
+		auto cold = std::chrono::steady_clock::now();
+		call(library);
+		auto warm = std::chrono::steady_clock::now();
+		times[0] = std::chrono::duration<double, std::nano>(opened - start).count();
+		times[1] = std::chrono::duration<double, std::nano>(cold - opened).count();
+		times[2] = std::chrono::duration<double, std::nano>(warm - cold).count();
+		if(write(fd, times, sizeof(times)) != sizeof(times)) {
+			_exit(1);
+		}
+		_exit(0);
+	}
+
+	/// Report the median over `samples` fresh processes of the cold and warm cost of `call(library)` as `benchmark`, made `startup` after loading the library, and of `dlopen` if `reportDlopen`.
+	template<typename Call> void benchmarkCold(const char *path, int samples, const char *benchmark, Call call, bool reportDlopen = false, std::chrono::milliseconds startup = {}) {
+		std::vector<double> dlopens, colds, warms;
+		for(int i = 0; i < samples; ++i) {
+			int fds[2];
+			if(pipe(fds) != 0) {
+				std::exit(1);
+			}
+			pid_t child = fork();
+			if(child == 0) {
+				close(fds[0]);
+				measureCold(path, call, startup, fds[1]);
+			}
+			close(fds[1]);
+			double times[3];
+			bool ok = read(fds[0], times, sizeof(times)) == sizeof(times);
+			close(fds[0]);
+			int status;
+			waitpid(child, &status, 0);
+			if(!ok) {
+				std::cerr << "Child process failed to measure " << benchmark << std::endl;
+				std::exit(1);
+			}
+			dlopens.push_back(times[0]);
+			colds.push_back(times[1]);
+			warms.push_back(times[2]);
+		}
+		for(auto *times : {&dlopens, &colds, &warms}) {
+			std::sort(times->begin(), times->end());
+		}
+		if(reportDlopen) {
+			report("dlopen", "libtestlib", dlopens[samples / 2]);
+		}
+		report(benchmark, "cold", colds[samples / 2]);
+		report(benchmark, "second call", warms[samples / 2]);
+	}
+}
+
+int main(int argc, const char *argv[]) {
+	const char *path = argc > 1 ? argv[1] : CXXFFI_TESTLIB_PATH;
+
+	// Measure cold start first, in child processes, before this process loads the library.
+	benchmarkCold(path, 15, "apply", [](void *library) {
+		keep(require<TableFunc>(library, "castsTable")());
+	}, true);
+	// Registered mode resolves symbols with `dladdr`, so a single type's query only resolves its own upcasts.
+	benchmarkCold(path, 15, "registered apply", [](void *library) {
+		keep(require<TableFunc>(library, "registeredCastsTable")());
+	});
+	benchmarkCold(path, 15, "registered type_casts", [](void *library) {
+		keep(require<TypeCastsFunc>(library, "registeredCastsTable_type_casts")("std::shared_ptr<D>"));
+	});
+	// A background table starts generating when loaded, so waiting for it costs less the more other startup work overlaps it.
+	benchmarkCold(path, 15, "background wait", [](void *library) {
+		keep(require<TableFunc>(library, "backgroundCastsTable_wait")());
+	});
+	benchmarkCold(path, 15, "background wait after 5ms", [](void *library) {
+		keep(require<TableFunc>(library, "backgroundCastsTable_wait")());
+	}, false, std::chrono::milliseconds(5));
+
+	void *library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if(!library) {
+		std::cerr << "Couldn't load " << path << ": " << dlerror() << std::endl;
+		return 1;
+	}
+	TableFunc table = require<TableFunc>(library, "castsTable");
+	BinaryFunc binary = require<BinaryFunc>(library, "castsTable_binary");
+	TypeIdFunc typeId = require<TypeIdFunc>(library, "castsTable_type_id");
+	FindUpcastFunc findUpcast = require<FindUpcastFunc>(library, "castsTable_find_upcast");
+	IsSubtypeFunc isSubtype = require<IsSubtypeFunc>(library, "castsTable_is_subtype");
+	keep(table());
+	const void *binaryTable = binary();
+
+	report("apply", "warm", timePerOp(iterations, [&](std::size_t) {
+		keep(table());
+	}));
+
+	// The lookups a binding layer performs to turn a pair of type names into a callable upcast.
+	report("lookup", "dlsym by mangled name", timePerOp(iterations / 16, [&](std::size_t) {
+		keep(dlsym(library, "_ZN6CxxFFI6upcastI1D1AEEPT0_PT_"));
+	}));
+	report("lookup", "type_id by name", timePerOp(iterations, [&](std::size_t) {
+		keep(typeId("std::shared_ptr<D>"));
+	}));
+	std::uint32_t d = typeId("D"), a = typeId("A");
+	report("lookup", "find_upcast by type id", timePerOp(iterations, [&](std::size_t i) {
+		keep(findUpcast(d, (i & 1) ? a : d));
+	}));
+	report("lookup", "is_subtype by type id", timePerOp(iterations, [&](std::size_t i) {
+		keep(isSubtype((i & 1) ? a : d, (i & 2) ? a : d));
+	}));
+
+	benchmarkRaw<D, C>("D->C (non-virtual, multiple)", requireCasts(typeId, findUpcast, binaryTable, "D", "C"));
+	benchmarkRaw<C, A>("C->A (virtual)", requireCasts(typeId, findUpcast, binaryTable, "C", "A"));
+	benchmarkRaw<D, A>("D->A (diamond)", requireCasts(typeId, findUpcast, binaryTable, "D", "A"));
+	benchmarkShared<E, D>("E->D (single)", requireCasts(typeId, findUpcast, binaryTable, "std::shared_ptr<E>", "std::shared_ptr<D>"));
+	benchmarkShared<B, A>("B->A (virtual)", requireCasts(typeId, findUpcast, binaryTable, "std::shared_ptr<B>", "std::shared_ptr<A>"));
+	benchmarkShared<D, A>("D->A (diamond)", requireCasts(typeId, findUpcast, binaryTable, "std::shared_ptr<D>", "std::shared_ptr<A>"));
+	benchmarkIntrusive<J, I>("J->I (single)", requireCasts(typeId, findUpcast, binaryTable, "boost::intrusive_ptr<J>", "boost::intrusive_ptr<I>"));
+	return 0;
+}
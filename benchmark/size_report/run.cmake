@@ -0,0 +1,119 @@
+# Code size report: generates a synthetic, non-virtual hierarchy with
+# GenerateHierarchy.cmake, builds it as a shared library twice, once with every
+# upcast instantiated separately (CXXFFI_SHARED_UPCAST_LIMIT=0) and once with
+# constant-offset upcasts sharing one thunk per offset (the default), and appends
+# a JSON object per build to results.jsonl in WORK_DIR, with the fields `variant`,
+# `library_bytes`, `text_bytes`, `dynsym_bytes`, `upcast_symbols`, `upcast_bytes`
+# (the exported CxxFFI::upcast and upcastN instantiations), and `shared_symbols`
+# and `shared_bytes` (the exported upcastByOffset and upcastNByOffset thunks).
+#
+# Run via the bench-size-report target, or directly as
+#   cmake -DCXX=... -DREADELF=... -DNM=... -DWORK_DIR=... [-DINCLUDES=dir:dir]
+#         [-DLIBS=lib:lib] [-DFLAGS="-O2 ..."] [-DCONFIG=classes:depth:functions]
+#         -P run.cmake
+#
+# Copyright: Geopipe, Inc.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+cmake_minimum_required(VERSION 3.15.0)
+include(${CMAKE_CURRENT_LIST_DIR}/../compile_time/GenerateHierarchy.cmake)
+
+foreach(required CXX READELF NM WORK_DIR)
+	if(NOT DEFINED ${required})
+		message(FATAL_ERROR "run.cmake requires -D${required}=...")
+	endif()
+endforeach()
+if(NOT DEFINED CONFIG)
+	set(CONFIG "400:8:200")
+endif()
+if(NOT DEFINED FLAGS)
+	set(FLAGS "-O2")
+endif()
+separate_arguments(FLAGS UNIX_COMMAND "${FLAGS}")
+get_filename_component(repoInclude "${CMAKE_CURRENT_LIST_DIR}/../../include" ABSOLUTE)
+set(includeFlags "-I${repoInclude}")
+if(INCLUDES)
+	string(REPLACE ":" ";" INCLUDES "${INCLUDES}")
+	foreach(dir IN LISTS INCLUDES)
+		list(APPEND includeFlags "-I${dir}")
+	endforeach()
+endif()
+string(REPLACE ":" ";" LIBS "${LIBS}")
+
+string(REPLACE ":" ";" fields "${CONFIG}")
+list(LENGTH fields fieldCount)
+if(NOT fieldCount EQUAL 3)
+	message(FATAL_ERROR "Malformed configuration '${CONFIG}', expected classes:depth:functions")
+endif()
+list(GET fields 0 classes)
+list(GET fields 1 depth)
+list(GET fields 2 functions)
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+set(source "${WORK_DIR}/hierarchy-${classes}-${depth}-${functions}.cc")
+cxxffi_generate_hierarchy("${source}" CLASSES ${classes} DEPTH ${depth} FANOUT 1 DIAMONDS 0 FUNCTIONS ${functions} NONVIRTUAL)
+set(results "${WORK_DIR}/results.jsonl")
+file(WRITE "${results}" "")
+
+# Sum the sizes (the second, hexadecimal, column of `nm -S`) of the symbols in `LINES` matching `PATTERN`, and count them.
+function(_cxxffi_sum_symbols LINES PATTERN COUNT BYTES)
+	set(count 0)
+	set(bytes 0)
+	foreach(line IN LISTS LINES)
+		if(line MATCHES "^[0-9a-f]+ ([0-9a-f]+) [A-Za-z] (${PATTERN})")
+			math(EXPR count "${count} + 1")
+			math(EXPR bytes "${bytes} + 0x${CMAKE_MATCH_1}")
+		endif()
+	endforeach()
+	set(${COUNT} ${count} PARENT_SCOPE)
+	set(${BYTES} ${bytes} PARENT_SCOPE)
+endfunction()
+
+foreach(variant separate shared)
+	if(variant STREQUAL "separate")
+		set(limit 0)
+	else()
+		set(limit 64)
+	endif()
+	set(library "${WORK_DIR}/lib${variant}.so")
+	message(STATUS "Building ${classes} classes, depth ${depth}, ${functions} functions, with ${variant} upcasts")
+	execute_process(
+		COMMAND "${CXX}" -std=c++17 -fPIC -shared ${FLAGS} -DCXXFFI_SHARED_UPCAST_LIMIT=${limit} ${includeFlags} "${source}" -o "${library}" ${LIBS} -ldl -pthread
+		RESULT_VARIABLE exitCode
+		ERROR_VARIABLE report)
+	if(NOT exitCode EQUAL 0)
+		message(FATAL_ERROR "Compilation failed with exit code ${exitCode}:\n${report}")
+	endif()
+	file(SIZE "${library}" libraryBytes)
+
+	# Section lines look like "  [13] .text  PROGBITS  0000000000012340 012340 0a1b2c 00  AX  0   0 16".
+	execute_process(COMMAND "${READELF}" -S -W "${library}" OUTPUT_VARIABLE sections)
+	foreach(section text dynsym)
+		set(${section}Bytes 0)
+		if(sections MATCHES "\\.${section} +[A-Z_]+ +[0-9a-f]+ +[0-9a-f]+ +([0-9a-f]+)")
+			math(EXPR ${section}Bytes "0x${CMAKE_MATCH_1}")
+		endif()
+	endforeach()
+
+	execute_process(COMMAND "${NM}" -D -S --defined-only "${library}" OUTPUT_VARIABLE symbols)
+	string(REPLACE "\n" ";" symbols "${symbols}")
+	_cxxffi_sum_symbols("${symbols}" "_ZN6CxxFFI6upcastI|_ZN6CxxFFI7upcastNI" upcastSymbols upcastBytes)
+	_cxxffi_sum_symbols("${symbols}" "_ZN6CxxFFI14upcastByOffsetI|_ZN6CxxFFI15upcastNByOffsetI" sharedSymbols sharedBytes)
+
+	set(line "{\"classes\":${classes},\"depth\":${depth},\"functions\":${functions},\"variant\":\"${variant}\",\"library_bytes\":${libraryBytes},\"text_bytes\":${textBytes},\"dynsym_bytes\":${dynsymBytes},\"upcast_symbols\":${upcastSymbols},\"upcast_bytes\":${upcastBytes},\"shared_symbols\":${sharedSymbols},\"shared_bytes\":${sharedBytes}}")
+	file(APPEND "${results}" "${line}\n")
+	message(STATUS "${line}")
+endforeach()
+message(STATUS "Results written to ${results}")
@@ -0,0 +1,82 @@
+/************************************************************************************
+ * @file symbol_matching.cc
+ * Compares the cost of recognizing `CxxFFI::upcast` symbols by demangling every
+ * symbol and matching the known-types regex (the original approach) against
+ * `CxxFFI::detail::UpcastSymbolMatcher`, over a synthetic symbol table.
+ *
+ * Usage: `bench-symbol-matching [symbol count]`, defaulting to 500000 symbols.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include "synthetic_symbols.hpp"
+
+#include <re2/re2.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Time `f`, returning its result and the elapsed milliseconds.
+template<typename F> std::pair<std::size_t, double> timed(F f) {
+	auto start = std::chrono::steady_clock::now();
+	std::size_t result = f();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return {result, elapsed.count()};
+}
+
+int main(int argc, const char *argv[]) {
+	std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 500000;
+	std::vector<std::string> symbols = syntheticSymbols(count);
+
+	auto legacy = timed([&]() {
+		std::string knownTypes = CxxFFI::detail::MatchKnownTypes<KnownTypes>::apply();
+		std::string matchUpcastSrc = knownTypes + re2::RE2::QuoteMeta("*") + "\\s+" + re2::RE2::QuoteMeta("CxxFFI::upcast<") + knownTypes + re2::RE2::QuoteMeta(",") + "\\s*" + knownTypes + "\\s*" + re2::RE2::QuoteMeta(">(") + knownTypes + re2::RE2::QuoteMeta("*)");
+		re2::RE2 matchUpcast(matchUpcastSrc);
+		std::string returnType, derivedType, baseType, argType;
+		std::size_t matches = 0;
+		for(const std::string& symbol : symbols) {
+			std::string readable(boost::core::demangle(symbol.c_str()));
+			if(re2::RE2::FullMatch(readable, matchUpcast, &returnType, &derivedType, &baseType, &argType) && returnType == baseType && argType == derivedType) {
+				++matches;
+			}
+		}
+		return matches;
+	});
+
+	auto prefix = timed([&]() {
+		CxxFFI::detail::UpcastSymbolMatcher matcher;
+		addKnownTypes(matcher, KnownTypes());
+		std::string derivedType, baseType;
+		std::size_t matches = 0;
+		for(const std::string& symbol : symbols) {
+			if(matcher.match(symbol, derivedType, baseType)) {
+				++matches;
+			}
+		}
+		return matches;
+	});
+
+	std::cout << "symbols=" << count << " known_types=" << KnownTypes::size
+	          << " legacy_matches=" << legacy.first << " legacy_ms=" << legacy.second
+	          << " prefix_matches=" << prefix.first << " prefix_ms=" << prefix.second
+	          << " speedup=" << legacy.second / prefix.second << std::endl;
+	return legacy.first == prefix.first ? 0 : 1;
+}
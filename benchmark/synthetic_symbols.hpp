@@ -0,0 +1,67 @@
+#pragma once
+/************************************************************************************
+ * @file synthetic_symbols.hpp
+ * A synthetic symbol table, and the known types whose upcasts it contains, shared
+ * by the symbol scanning benchmarks.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <cxx-ffi/casts_table.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Root {};
+template<int N> struct Leaf : Root {};
+
+/// The number of `Leaf` types, each of which has an upcast to `Root`.
+constexpr int leafCount = 64;
+
+/// `CxxFFI::TypeList` of `Root` and every `Leaf`.
+template<typename Seq> struct KnownTypesOf;
+template<int ...Ns> struct KnownTypesOf<std::integer_sequence<int, Ns...>> {
+	using type = CxxFFI::TypeList<Root, Leaf<Ns>...>;
+};
+using KnownTypes = typename KnownTypesOf<std::make_integer_sequence<int, leafCount>>::type;
+
+/// Add the name of each of `Ts...` to `matcher`.
+template<typename ...Ts> void addKnownTypes(CxxFFI::detail::UpcastSymbolMatcher &matcher, CxxFFI::TypeList<Ts...>) {
+	(matcher.addType(CxxFFI::detail::readableName<Ts>()), ...);
+}
+
+/// Build a symbol table of `count` symbols, a few of which are upcasts, and the rest typical C++ functions.
+inline std::vector<std::string> syntheticSymbols(std::size_t count) {
+	std::vector<std::string> symbols;
+	symbols.reserve(count);
+	std::size_t stride = count / leafCount;
+	for(std::size_t i = 0; i < count; ++i) {
+		std::string n = std::to_string(i);
+		if(stride && i % stride == 0 && i / stride < leafCount) {
+			symbols.push_back("_ZN6CxxFFI6upcastI4LeafILi" + std::to_string(i / stride) + "EE4RootEEPT0_PT_");
+		} else if(i % 7 == 0) {
+			symbols.push_back("_ZN6CxxFFI7upcastNI4LeafILi" + n + "EE4RootEEvPKPT_PPT0_m");
+		} else if(i % 3 == 0) {
+			symbols.push_back("_ZN5bench6fillerILi" + n + "EEEvPid");
+		} else {
+			std::string widget = "Widget" + n;
+			symbols.push_back("_ZN5bench" + std::to_string(widget.size()) + widget + "6methodERKSt6vectorIiSaIiEE");
+		}
+	}
+	return symbols;
+}
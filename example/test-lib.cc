@@ -11,6 +11,14 @@ namespace CxxFFI {
 	template<> struct APIFilter<A> {
 		using type = boost::mpl::bool_<true>;
 	};
+	
+	template<> struct APIFilter<F> {
+		using type = boost::mpl::bool_<true>;
+	};
+	
+	template<> struct APIFilter<I> {
+		using type = boost::mpl::bool_<true>;
+	};
 }
 
 
@@ -18,6 +26,10 @@ A& aRefFromDRef(D& d){
 	return d;
 }
 
+C& cRefFromDRef(D& d){
+	return d;
+}
+
 std::shared_ptr<B> sharedBFromSharedDAnd(std::shared_ptr<D> &d) {
 	return std::static_pointer_cast<B>(d);
 }
@@ -26,4 +38,39 @@ std::shared_ptr<C> sharedCFromSharedDStar(std::shared_ptr<D> *d) {
 	return std::static_pointer_cast<C>(*d);
 }
 
-CXXFFI_EXPOSE(castsTable, testLoc, (aRefFromDRef)(sharedBFromSharedDAnd)(sharedCFromSharedDStar));
+std::shared_ptr<A> sharedAFromSharedE(std::shared_ptr<E> e) {
+	return e;
+}
+
+F& fRefFromHRef(H& h) {
+	return h;
+}
+
+std::shared_ptr<G> sharedGFromSharedH(std::shared_ptr<H> h) {
+	return h;
+}
+
+std::unique_ptr<G> uniqueGFromUniqueH(std::unique_ptr<H> h) {
+	return h;
+}
+
+boost::intrusive_ptr<I> intrusiveIFromIntrusiveJ(boost::intrusive_ptr<J> j) {
+	return j;
+}
+
+// `E : D : B, C` are all non-virtual steps, but `B` and `C` reach `A` virtually.
+static_assert(CxxFFI::detail::IsNonVirtualBase<E, D>::value && CxxFFI::detail::IsNonVirtualBase<E, B>::value && CxxFFI::detail::IsNonVirtualBase<D, C>::value, "Non-virtual bases have constant offsets");
+static_assert(!CxxFFI::detail::IsNonVirtualBase<E, A>::value && !CxxFFI::detail::IsNonVirtualBase<B, A>::value, "Virtual bases don't have constant offsets");
+static_assert(CxxFFI::detail::IsStaticUpcast<E, A>::value && CxxFFI::detail::IsStaticUpcast<D, A>::value, "Virtual but unambiguous bases don't need dynamic_pointer_cast");
+// `H : G : F` is a single-inheritance chain, so downcasts within it are checked by interval numbering.
+// `std::unique_ptr` and `boost::intrusive_ptr` are `CovariantHandle`s, so they inherit the reflected bases of their elements.
+static_assert(std::is_same<CxxFFI::ReflBases<std::unique_ptr<H>>::type, CxxFFI::TypeList<std::unique_ptr<G>>>::value && CxxFFI::detail::IsHandle<boost::intrusive_ptr<J>>::value, "Covariant handles reflect their elements' bases");
+static_assert(CxxFFI::detail::IsSingleChain<H>::value && CxxFFI::detail::IsSingleChain<std::shared_ptr<H>>::value && !CxxFFI::detail::IsSingleChain<E>::value, "Only single, non-virtual inheritance forms chains");
+
+CXXFFI_EXPOSE(castsTable, testLoc, (aRefFromDRef)(cRefFromDRef)(sharedBFromSharedDAnd)(sharedCFromSharedDStar)(sharedAFromSharedE)(fRefFromHRef)(sharedGFromSharedH)(uniqueGFromUniqueH)(intrusiveIFromIntrusiveJ));
+CXXFFI_EXPOSE_REGISTERED(registeredCastsTable, (aRefFromDRef)(cRefFromDRef)(sharedBFromSharedDAnd)(sharedCFromSharedDStar)(sharedAFromSharedE)(fRefFromHRef)(sharedGFromSharedH)(uniqueGFromUniqueH)(intrusiveIFromIntrusiveJ));
+CXXFFI_EXPOSE_LOOKUP(castsTable);
+// A second scanned table in the same library, which reuses the first's scan via the registry.
+CXXFFI_EXPOSE(chainCastsTable, testLoc, (fRefFromHRef)(sharedGFromSharedH));
+CXXFFI_EXPOSE_REGISTERED_BACKGROUND(backgroundCastsTable, (aRefFromDRef)(cRefFromDRef));
+CXXFFI_EXPOSE_REGISTRY();
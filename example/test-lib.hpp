@@ -15,3 +15,39 @@ struct C : virtual A {
 struct D : B, C {
 	using ReflBases = CxxFFI::DefineBases<B, C>;
 };
+
+struct E : D {
+	using ReflBases = CxxFFI::DefineBases<D>;
+};
+
+struct F {
+	virtual ~F() = default;
+};
+
+struct G : F {
+	using ReflBases = CxxFFI::DefineBases<F>;
+};
+
+struct H : G {
+	using ReflBases = CxxFFI::DefineBases<G>;
+};
+
+/// Reference counted intrusively, for `boost::intrusive_ptr`.
+struct I {
+	int references = 0;
+	virtual ~I() = default;
+	
+	friend void intrusive_ptr_add_ref(I *i) {
+		++i->references;
+	}
+	
+	friend void intrusive_ptr_release(I *i) {
+		if(!--i->references) {
+			delete i;
+		}
+	}
+};
+
+struct J : I {
+	using ReflBases = CxxFFI::DefineBases<I>;
+};
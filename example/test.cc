@@ -1,9 +1,171 @@
+#include "test-lib.hpp"
+
+#include <cxx-ffi/binary_table.hpp>
+#include <cxx-ffi/cast_lookup.hpp>
+#include <cxx-ffi/casts_stats.hpp>
+#include <cxx-ffi/registry.hpp>
+#include <cxx-ffi/subtype_matrix.hpp>
+
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
 
 extern "C" {
 	extern const char * castsTable();
+	extern const char * registeredCastsTable();
+	extern const void * castsTable_binary();
+	extern CxxFFI::CastsTableStats castsTable_stats();
+	extern const char * chainCastsTable();
+	extern CxxFFI::CastsTableStats chainCastsTable_stats();
+	extern const char * chainCastsTable_type_casts(const char*);
+	extern int chainCastsTable_for_each_cast(const char*, CxxFFI::CastVisitor, void*);
+	extern const char * backgroundCastsTable();
+	extern const char * backgroundCastsTable_wait();
+	extern int backgroundCastsTable_ready();
+	extern const char * cxxffi_registry_casts_table();
+	extern const char * cxxffi_registry_library_casts_table(const void*);
+	extern CxxFFI::RegistryStats cxxffi_registry_stats();
+	extern std::uint32_t cxxffi_type_id(const char*);
+	extern void (*cxxffi_find_upcast(std::uint32_t, std::uint32_t))();
+	extern void (*cxxffi_find_downcast(std::uint32_t, std::uint32_t))();
+	extern int cxxffi_is_subtype(std::uint32_t, std::uint32_t);
+	extern const void * cxxffi_subtypes();
+}
+
+/// Walk the binary casts table in place, as an FFI runtime would.
+void printBinaryTable(const void *table) {
+	const unsigned char *bytes = static_cast<const unsigned char*>(table);
+	const CxxFFI::BinaryTableHeader *header = static_cast<const CxxFFI::BinaryTableHeader*>(table);
+	const CxxFFI::BinaryTypeRecord *types = reinterpret_cast<const CxxFFI::BinaryTypeRecord*>(bytes + header->typesOffset);
+	const CxxFFI::BinaryCastRecord *casts = reinterpret_cast<const CxxFFI::BinaryCastRecord*>(bytes + header->castsOffset);
+	const char *strings = reinterpret_cast<const char*>(bytes + header->stringsOffset);
+	std::cout << "binary table v" << header->version << ", " << header->totalSize << " bytes" << std::endl;
+	for(std::uint32_t i = 0; i < header->typeCount; ++i) {
+		std::cout << "\t" << i << ": " << strings + types[i].name << " (" << types[i].size << " bytes, align " << types[i].align << ")";
+		if(types[i].pre != UINT32_MAX) {
+			std::cout << ", interval [" << types[i].pre << ", " << types[i].post << "]";
+		}
+		if(types[i].destroy.length) {
+			std::cout << ", destroy via " << strings + types[i].destroy.name;
+		}
+		std::cout << std::endl;
+		for(std::uint32_t j = types[i].firstCast; j < types[i].firstCast + types[i].castCount; ++j) {
+			std::cout << "\t\t-> " << casts[j].base << " via " << strings + casts[j].upcast.name;
+			if(casts[j].flags & CxxFFI::CastHasConstantOffset) {
+				std::cout << ", or offset " << casts[j].offset;
+			}
+			if(casts[j].upcastN.length) {
+				std::cout << ", batched via " << strings + casts[j].upcastN.name;
+			}
+			if(casts[j].upcastInto.length) {
+				std::cout << ", in place via " << strings + casts[j].upcastInto.name;
+			}
+			if(casts[j].flags & CxxFFI::CastRetypesInPlace) {
+				std::cout << ", retyping its argument";
+			}
+			if(casts[j].downcast.length) {
+				std::cout << ", inverse " << (casts[j].flags & CxxFFI::CastDowncastByInterval ? "by interval" : "by dynamic_cast") << " via " << strings + casts[j].downcast.name;
+			}
+			std::cout << std::endl;
+		}
+	}
 }
 
 int main(int argc, const char *argv[]) {
 	std::cout << castsTable() << std::endl;
+	std::cout << registeredCastsTable() << std::endl;
+	printBinaryTable(castsTable_binary());
+
+	// Resolve and invoke an upcast by type id, as a binding layer would.
+	std::uint32_t d = cxxffi_type_id("D"), c = cxxffi_type_id("C");
+	auto dToC = reinterpret_cast<C*(*)(D*)>(cxxffi_find_upcast(d, c));
+	D obj;
+	std::cout << "D -> C by lookup: " << (dToC && dToC(&obj) == static_cast<C*>(&obj) ? "ok" : "FAILED") << std::endl;
+	std::cout << "C -> D by lookup: " << (cxxffi_find_upcast(c, d) ? "FAILED" : "ok") << std::endl;
+	
+	// Checked downcasts return null unless the object really is of the derived type.
+	std::uint32_t f = cxxffi_type_id("F"), h = cxxffi_type_id("H");
+	auto fToH = reinterpret_cast<H*(*)(F*)>(cxxffi_find_downcast(f, h));
+	H hObj;
+	G gObj;
+	std::cout << "F -> H by lookup: " << (fToH && fToH(&hObj) == &hObj && !fToH(&gObj) && !fToH(nullptr) ? "ok" : "FAILED") << std::endl;
+	std::cout << "A -> D by lookup: " << (cxxffi_find_downcast(cxxffi_type_id("A"), d) ? "FAILED" : "ok") << std::endl;
+	
+	// Covariant handles are retyped in place, so nothing is allocated, and the reference is moved rather than counted again.
+	using JHandle = boost::intrusive_ptr<J>;
+	using IHandle = boost::intrusive_ptr<I>;
+	std::uint32_t jHandleId = cxxffi_type_id("boost::intrusive_ptr<J>"), iHandleId = cxxffi_type_id("boost::intrusive_ptr<I>");
+	auto jToI = reinterpret_cast<IHandle*(*)(JHandle*)>(cxxffi_find_upcast(jHandleId, iHandleId));
+	auto iToJ = reinterpret_cast<JHandle*(*)(IHandle*)>(cxxffi_find_downcast(iHandleId, jHandleId));
+	J *jObj = new J();
+	alignas(JHandle) unsigned char storage[sizeof(JHandle)];
+	JHandle *jHandle = new (storage) JHandle(jObj);
+	IHandle *iHandle = jToI ? jToI(jHandle) : nullptr;
+	bool up = static_cast<void*>(iHandle) == storage && iHandle->get() == jObj && jObj->references == 1;
+	JHandle *back = up && iToJ ? iToJ(iHandle) : nullptr;
+	bool down = static_cast<void*>(back) == storage && back->get() == jObj && jObj->references == 1;
+	std::cout << "intrusive_ptr<J> -> intrusive_ptr<I> in place: " << (up ? "ok" : "FAILED") << ", and back: " << (down ? "ok" : "FAILED") << std::endl;
+	if(down) {
+		back->~JHandle();
+	}
+	using HUnique = std::unique_ptr<H>;
+	using GUnique = std::unique_ptr<G>;
+	auto hToG = reinterpret_cast<GUnique*(*)(HUnique*)>(cxxffi_find_upcast(cxxffi_type_id("std::unique_ptr<H>"), cxxffi_type_id("std::unique_ptr<G>")));
+	H *hOwned = new H();
+	HUnique hUnique(hOwned);
+	GUnique *gUnique = hToG ? hToG(&hUnique) : nullptr;
+	bool moved = static_cast<void*>(gUnique) == &hUnique && gUnique->get() == hOwned;
+	std::cout << "unique_ptr<H> -> unique_ptr<G> in place: " << (moved ? "ok" : "FAILED") << std::endl;
+	if(moved) {
+		// `hUnique`'s storage now holds a `GUnique`, so destroy that, and then put back an empty `HUnique` for its destructor.
+		gUnique->~GUnique();
+		new (&hUnique) HUnique();
+	}
+	
+	// Is-a queries, via the function and by reading the matrix directly.
+	std::uint32_t a = cxxffi_type_id("A");
+	const CxxFFI::SubtypeMatrixHeader *matrix = static_cast<const CxxFFI::SubtypeMatrixHeader*>(cxxffi_subtypes());
+	const std::uint64_t *words = reinterpret_cast<const std::uint64_t*>(reinterpret_cast<const unsigned char*>(matrix) + matrix->headerSize);
+	bool dIsA = (words[d * matrix->rowWords + a / 64] >> (a % 64)) & 1;
+	std::cout << "subtype matrix: " << matrix->typeCount << " types, D <: A " << (cxxffi_is_subtype(d, a) && dIsA ? "ok" : "FAILED")
+	          << ", A <: D " << (cxxffi_is_subtype(a, d) ? "FAILED" : "ok") << ", H <: F " << (cxxffi_is_subtype(h, f) ? "ok" : "FAILED") << std::endl;
+
+	// Query one type, and stream every entry, without generating the whole table.
+	int entries = 0;
+	CxxFFI::CastVisitor countEntry = [](const char*, const char*, const char*, void *context) {
+		++*static_cast<int*>(context);
+		return 0;
+	};
+	const char *hCasts = chainCastsTable_type_casts("H");
+	chainCastsTable_for_each_cast(nullptr, countEntry, &entries);
+	bool lazy = chainCastsTable_stats().jsonBytes == 0;
+	std::cout << "lazy queries: H : " << hCasts << ", " << entries << " entries, unknown type " << (chainCastsTable_type_casts("Z") ? "FAILED" : "ok")
+	          << ", whole table not generated " << (lazy ? "ok" : "FAILED") << ", consistent with whole table "
+	          << (std::strstr(chainCastsTable(), ("\"H\" : " + std::string(hCasts)).c_str()) ? "ok" : "FAILED") << std::endl;
+
+	// The background table began generating when the library was loaded; waiting shares that work, and then it is soon ready.
+	const char *background = backgroundCastsTable_wait();
+	while(!backgroundCastsTable_ready()) {
+		std::this_thread::yield();
+	}
+	std::cout << "background: " << (background == backgroundCastsTable() && std::strstr(background, "\"D\" : {") ? "ok" : "FAILED") << std::endl;
+	
+	// Both scanned tables share one scan of the library, and the registry merges all four tables.
+	CxxFFI::RegistryStats registry = cxxffi_registry_stats();
+	std::cout << "registry: " << registry.tables << " tables, " << registry.imageScans << " scan, " << registry.sharedScans << " shared, chainCastsTable shared "
+	          << (chainCastsTable_stats().sharedScan && !castsTable_stats().sharedScan ? "ok" : "FAILED") << ", merged "
+	          << (std::strcmp(cxxffi_registry_casts_table(), castsTable()) == 0 ? "ok" : "FAILED") << ", library "
+	          << (std::strcmp(cxxffi_registry_library_casts_table(reinterpret_cast<const void*>(&castsTable)), castsTable()) == 0 ? "ok" : "FAILED") << std::endl;
+
+	// Timings vary from run to run, so print them to stderr.
+	CxxFFI::CastsTableStats stats = castsTable_stats();
+	std::cerr << "stats: cacheHit=" << stats.cacheHit << " symbolLoadNs=" << stats.symbolLoadNs << " demangleNs=" << stats.demangleNs
+	          << " matchNs=" << stats.matchNs << " mapBuildNs=" << stats.mapBuildNs << " jsonEmitNs=" << stats.jsonEmitNs
+	          << " binaryEmitNs=" << stats.binaryEmitNs << " symbolsScanned=" << stats.symbolsScanned << " symbolsDemangled=" << stats.symbolsDemangled
+	          << " symbolsMatched=" << stats.symbolsMatched << " castsFound=" << stats.castsFound << " castsMissing=" << stats.castsMissing
+	          << " jsonBytes=" << stats.jsonBytes << " binaryBytes=" << stats.binaryBytes << " sharedScan=" << stats.sharedScan << " castsShared=" << stats.castsShared << std::endl;
 };
@@ -0,0 +1,239 @@
+#pragma once
+/************************************************************************************
+ * @file binary_table.hpp
+ * A compact, versioned, binary encoding of the casts table which FFI runtimes can
+ * read in place, without parsing or copying.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/******************************************************
+ * Layout of the binary casts table. All integers are
+ * in native byte order, and all offsets are in bytes
+ * relative to the start of the `BinaryTableHeader`.
+ * The table is laid out as:
+ * <pre class="markdeep">
+ * ```
+ * +-------------------+
+ * | BinaryTableHeader |
+ * +-------------------+
+ * | BinaryTypeRecord  | x typeCount, indexed by type id
+ * +-------------------+
+ * | BinaryCastRecord  | x castCount, grouped by derived type
+ * +-------------------+
+ * | strings           | NUL-terminated, interned
+ * +-------------------+
+ * ```
+ * </pre>
+ * The equivalent C declarations for use with an FFI
+ * are obtained by replacing `std::uint32_t` with
+ * `uint32_t`, etc.
+ ******************************************************/
+namespace CxxFFI {
+	/// The fixed-size header at the start of every binary casts table.
+	struct BinaryTableHeader {
+		char magic[8]; ///< Always `"CXXFFIBT"` (not NUL-terminated).
+		std::uint32_t version; ///< Incremented whenever the layout changes. See `BinaryTableHeader::currentVersion`.
+		std::uint32_t headerSize; ///< `sizeof(BinaryTableHeader)`, to permit appending fields in later versions.
+		std::uint32_t totalSize; ///< Size in bytes of the entire table, including this header.
+		std::uint32_t typeCount; ///< Number of `BinaryTypeRecord`s.
+		std::uint32_t castCount; ///< Number of `BinaryCastRecord`s.
+		std::uint32_t typesOffset; ///< Offset of the first `BinaryTypeRecord`.
+		std::uint32_t castsOffset; ///< Offset of the first `BinaryCastRecord`.
+		std::uint32_t stringsOffset; ///< Offset of the string table.
+		std::uint32_t stringsSize; ///< Size in bytes of the string table.
+		std::uint32_t typeRecordSize; ///< `sizeof(BinaryTypeRecord)`. Readers should stride by this, to permit appending fields in later versions.
+		std::uint32_t castRecordSize; ///< `sizeof(BinaryCastRecord)`. Readers should stride by this, to permit appending fields in later versions.
+		std::uint32_t reserved; ///< Always zero.
+
+		static constexpr std::uint32_t currentVersion = 5; ///< The layout version written by this header.
+	};
+
+	/// Refers to a function exported from the library, by symbol and by address.
+	struct BinarySymbol {
+		std::uint32_t name; ///< Offset of the symbol (for use with `dlsym`) within the string table.
+		std::uint32_t length; ///< Length of the symbol, or zero if it couldn't be discovered.
+		std::uint64_t fn; ///< Address of the function in the current process, or zero if unknown or not applicable.
+	};
+
+	/// Describes one type in the casts table. A type's id is its index in the array of `BinaryTypeRecord`s.
+	struct BinaryTypeRecord {
+		std::uint32_t name; ///< Offset of the (rewritten) type name within the string table.
+		std::uint32_t nameLength; ///< Length of the type name, excluding the NUL terminator.
+		std::uint32_t firstCast; ///< Index of the first `BinaryCastRecord` for upcasts from this type.
+		std::uint32_t castCount; ///< Number of consecutive `BinaryCastRecord`s for upcasts from this type.
+		std::uint32_t size; ///< `sizeof` the type, i.e. the storage required by `CxxFFI::upcastInto`.
+		std::uint32_t align; ///< `alignof` the type, i.e. the alignment required by `CxxFFI::upcastInto`.
+		std::uint32_t pre; ///< Pre-order number of the type among single-inheritance chains, or `UINT32_MAX` if it has multiple or virtual bases. See `detail::TypeIntervals`.
+		std::uint32_t post; ///< Post-order number of the type among single-inheritance chains, or `UINT32_MAX`. A type is a subtype of another iff its `[pre, post]` is within the other's.
+		BinarySymbol destroy; ///< `CxxFFI::destroy` for this type, if it is a handle type.
+	};
+
+	/// Bits of `BinaryCastRecord::flags`.
+	enum BinaryCastFlags : std::uint32_t {
+		/**************************************************
+		 * The upcast is a pure pointer adjustment: a non-null
+		 * pointer to the derived type plus `BinaryCastRecord::offset`
+		 * is a pointer to the base type, and null maps to null.
+		 * If clear, the FFI must call `BinaryCastRecord::upcast`.
+		 **************************************************/
+		CastHasConstantOffset = 1u << 0,
+		/**************************************************
+		 * `BinaryCastRecord::downcast` decides subtyping by
+		 * comparing interval numbers whenever the dynamic type
+		 * is a chained type in this table, rather than always
+		 * costing a `dynamic_cast`.
+		 **************************************************/
+		CastDowncastByInterval = 1u << 1,
+		/**************************************************
+		 * `BinaryCastRecord::upcast`, `BinaryCastRecord::upcastN`
+		 * and `BinaryCastRecord::downcast` allocate nothing:
+		 * they retype the handle passed to them in place and
+		 * return its address, so the argument is consumed and
+		 * the result must not be freed separately. A failed
+		 * `downcast` leaves the argument intact. Set for
+		 * `CovariantHandle`s, such as `std::unique_ptr`.
+		 **************************************************/
+		CastRetypesInPlace = 1u << 2,
+	};
+
+	/// Describes one upcast from the owning `BinaryTypeRecord`'s type to one of its bases.
+	struct BinaryCastRecord {
+		std::uint32_t base; ///< Type id of the base type.
+		std::uint32_t flags; ///< Bitwise or of `BinaryCastFlags`.
+		BinarySymbol upcast; ///< `CxxFFI::upcast` from the derived type to the base type.
+		BinarySymbol upcastInto; ///< `CxxFFI::upcastInto` from the derived type to the base type, if the base is a handle type.
+		BinarySymbol upcastN; ///< `CxxFFI::upcastN` from the derived type to the base type.
+		BinarySymbol downcast; ///< `CxxFFI::downcast` from the base type to the derived type, if the base type is polymorphic.
+		std::int64_t offset; ///< Byte offset of the base subobject, if `CastHasConstantOffset` is set, otherwise zero.
+	};
+
+	static_assert(std::is_standard_layout<BinaryTableHeader>::value && sizeof(BinaryTableHeader) == 56, "BinaryTableHeader must have a stable layout");
+	static_assert(std::is_standard_layout<BinarySymbol>::value && sizeof(BinarySymbol) == 16, "BinarySymbol must have a stable layout");
+	static_assert(std::is_standard_layout<BinaryTypeRecord>::value && sizeof(BinaryTypeRecord) == 48, "BinaryTypeRecord must have a stable layout");
+	static_assert(std::is_standard_layout<BinaryCastRecord>::value && sizeof(BinaryCastRecord) == 80, "BinaryCastRecord must have a stable layout");
+
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/// A function to be referenced from the binary casts table by `BinarySymbol`.
+		struct PendingSymbol {
+			std::string name; ///< The symbol, or empty if unknown.
+			void (*fn)(); ///< The address, or `nullptr` if unknown.
+		};
+
+		/******************************************************
+		 * Accumulates types and upcasts, then serializes them
+		 * to the binary casts table layout. Type ids are
+		 * assigned in order of `BinaryTableBuilder::addType`.
+		 ******************************************************/
+		class BinaryTableBuilder {
+			std::vector<BinaryTypeRecord> types; ///< Type records, with `firstCast` yet to be assigned.
+			std::vector<std::vector<BinaryCastRecord>> casts; ///< Cast records, grouped by derived type id.
+			std::string strings; ///< The string table under construction. Offset zero is always the empty string.
+			std::unordered_map<std::string, std::uint32_t> interned; ///< Offsets of strings already in `BinaryTableBuilder::strings`.
+			std::size_t castCount = 0;
+
+			/// Return the offset of `s` in the string table, appending it if necessary.
+			std::uint32_t intern(const std::string& s) {
+				auto it = interned.find(s);
+				if(it != interned.end()) {
+					return it->second;
+				} else {
+					std::uint32_t offset = strings.size();
+					strings.append(s.c_str(), s.size() + 1);
+					interned.emplace(s, offset);
+					return offset;
+				}
+			}
+
+			/// Intern the name of `symbol`, and encode it as a `BinarySymbol`.
+			BinarySymbol encode(const PendingSymbol& symbol) {
+				return {intern(symbol.name), std::uint32_t(symbol.name.size()), std::uint64_t(reinterpret_cast<std::uintptr_t>(symbol.fn))};
+			}
+
+			/// Round `n` up to a multiple of 8, so that 64-bit fields remain aligned.
+			static std::size_t align8(std::size_t n) {
+				return (n + 7) & ~std::size_t(7);
+			}
+
+		public:
+			BinaryTableBuilder() : strings(1, '\0') {
+				interned.emplace("", 0);
+			}
+
+			/// Add a type named `name`, with the interval `[pre, post]`, returning its type id.
+			std::uint32_t addType(const std::string& name, std::size_t size, std::size_t align, std::uint32_t pre, std::uint32_t post, const PendingSymbol& destroy) {
+				types.push_back({intern(name), std::uint32_t(name.size()), 0, 0, std::uint32_t(size), std::uint32_t(align), pre, post, encode(destroy)});
+				casts.emplace_back();
+				return types.size() - 1;
+			}
+
+			/// Add an upcast from type id `derived` to type id `base`, with the given `BinaryCastFlags`.
+			void addCast(std::uint32_t derived, std::uint32_t base, std::uint32_t flags, std::int64_t offset, const PendingSymbol& upcast, const PendingSymbol& upcastInto, const PendingSymbol& upcastN, const PendingSymbol& downcast) {
+				casts.at(derived).push_back({base, flags, encode(upcast), encode(upcastInto), encode(upcastN), encode(downcast), offset});
+				++castCount;
+			}
+
+			/// Serialize the accumulated types and upcasts. The result begins with a `BinaryTableHeader`.
+			std::vector<unsigned char> finish() const {
+				BinaryTableHeader header = {};
+				std::memcpy(header.magic, "CXXFFIBT", sizeof(header.magic));
+				header.version = BinaryTableHeader::currentVersion;
+				header.headerSize = sizeof(BinaryTableHeader);
+				header.typeCount = types.size();
+				header.castCount = castCount;
+				header.typesOffset = align8(sizeof(BinaryTableHeader));
+				header.castsOffset = align8(header.typesOffset + types.size() * sizeof(BinaryTypeRecord));
+				header.stringsOffset = align8(header.castsOffset + castCount * sizeof(BinaryCastRecord));
+				header.stringsSize = strings.size();
+				header.typeRecordSize = sizeof(BinaryTypeRecord);
+				header.castRecordSize = sizeof(BinaryCastRecord);
+				header.totalSize = align8(header.stringsOffset + strings.size());
+
+				// Allocations from `operator new` are suitably aligned for the 64-bit fields in `BinarySymbol`.
+				std::vector<unsigned char> ans(header.totalSize, 0);
+				std::memcpy(ans.data(), &header, sizeof(header));
+				std::uint32_t firstCast = 0;
+				unsigned char *typeOut = ans.data() + header.typesOffset;
+				unsigned char *castOut = ans.data() + header.castsOffset;
+				for(std::size_t i = 0; i < types.size(); ++i) {
+					BinaryTypeRecord record = types[i];
+					record.firstCast = firstCast;
+					record.castCount = casts[i].size();
+					std::memcpy(typeOut, &record, sizeof(record));
+					typeOut += sizeof(record);
+					for(const BinaryCastRecord& castRecord : casts[i]) {
+						std::memcpy(castOut, &castRecord, sizeof(castRecord));
+						castOut += sizeof(castRecord);
+					}
+					firstCast += casts[i].size();
+				}
+				std::memcpy(ans.data() + header.stringsOffset, strings.data(), strings.size());
+				return ans;
+			}
+		};
+	}
+}
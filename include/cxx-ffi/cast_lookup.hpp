@@ -0,0 +1,112 @@
+#pragma once
+/************************************************************************************
+ * @file cast_lookup.hpp
+ * Constant-time runtime lookup of upcasts by type id, so FFI bindings can dispatch
+ * without parsing the casts table, comparing strings, or calling `dlsym`.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace CxxFFI {
+	/// Returned by type id lookups for names which don't appear in the casts table, i.e. `UINT32_MAX`.
+	constexpr std::uint32_t noTypeId = UINT32_MAX;
+
+	/**************************************************
+	 * The callback of `NAME_for_each_cast`, called with
+	 * the names of the derived and base types and the
+	 * symbol of the upcast between them (all valid only
+	 * for the duration of the call), and the caller's
+	 * `context`. Returning nonzero stops the iteration.
+	 **************************************************/
+	using CastVisitor = int (*)(const char *derived, const char *base, const char *symbol, void *context);
+
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/******************************************************
+		 * Maps type names to dense type ids via a hash table,
+		 * and pairs of type ids to upcasts and downcasts via
+		 * dense 2-D tables, so all lookups are O(1). Type ids
+		 * are assigned in order of `CastLookup::addType`, which
+		 * `CastsTable` keeps consistent with the binary table.
+		 ******************************************************/
+		class CastLookup {
+			std::unordered_map<std::string_view, std::uint32_t> ids; ///< Type ids, keyed by name.
+			std::vector<void (*)()> upcasts; ///< Row-major `typeCount() * typeCount()` table of upcasts, or `nullptr` where there is no upcast.
+			std::vector<void (*)()> downcasts; ///< As `CastLookup::upcasts`, but indexed by base then derived type id.
+			std::uint32_t count = 0; ///< The number of types added so far.
+
+		public:
+			/// Add a type named `name`, returning its type id. `name` must outlive the `CastLookup`.
+			std::uint32_t addType(std::string_view name) {
+				ids.emplace(name, count);
+				return count++;
+			}
+
+			/// Record `fn` as the upcast from type id `derived` to type id `base`. Must follow every call to `CastLookup::addType`.
+			void addCast(std::uint32_t derived, std::uint32_t base, void (*fn)()) {
+				if(upcasts.size() != std::size_t(count) * count) {
+					upcasts.assign(std::size_t(count) * count, nullptr);
+				}
+				upcasts[std::size_t(derived) * count + base] = fn;
+			}
+			
+			/// Record `fn` as the downcast from type id `base` to type id `derived`. Must follow every call to `CastLookup::addType`.
+			void addDowncast(std::uint32_t base, std::uint32_t derived, void (*fn)()) {
+				if(downcasts.size() != std::size_t(count) * count) {
+					downcasts.assign(std::size_t(count) * count, nullptr);
+				}
+				downcasts[std::size_t(base) * count + derived] = fn;
+			}
+
+			/// The number of types.
+			std::uint32_t typeCount() const {
+				return count;
+			}
+
+			/// The type id of `name`, or `noTypeId`.
+			std::uint32_t typeId(std::string_view name) const {
+				auto it = ids.find(name);
+				return it == ids.end() ? noTypeId : it->second;
+			}
+
+			/// The upcast from type id `derived` to type id `base`, or `nullptr` if there is none (or either id is invalid).
+			void (*findUpcast(std::uint32_t derived, std::uint32_t base) const)() {
+				if(derived >= count || base >= count || upcasts.empty()) {
+					return nullptr;
+				} else {
+					return upcasts[std::size_t(derived) * count + base];
+				}
+			}
+			
+			/// The downcast from type id `base` to type id `derived`, or `nullptr` if there is none (or either id is invalid).
+			void (*findDowncast(std::uint32_t base, std::uint32_t derived) const)() {
+				if(base >= count || derived >= count || downcasts.empty()) {
+					return nullptr;
+				} else {
+					return downcasts[std::size_t(base) * count + derived];
+				}
+			}
+		};
+	}
+}
@@ -0,0 +1,206 @@
+#pragma once
+/************************************************************************************
+ * @file casts_cache.hpp
+ * An opt-in, on-disk cache of generated casts tables, keyed by the build-id of the
+ * library, so that processes after the first can skip the symbol scan entirely.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <cxx-ffi/image_symbols.hpp>
+
+namespace CxxFFI {
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/******************************************************
+		 * Header of a cache file. It is followed by the build-id
+		 * (as hex), then the JSON casts table, then one symbol
+		 * per upcast in `HierarchyDescription::upcasts` order,
+		 * each NUL-terminated. All integers are in native byte
+		 * order; caches aren't meant to be shared between machines.
+		 ******************************************************/
+		struct CastsCacheHeader {
+			char magic[8]; ///< Always `"CXXFFICC"` (not NUL-terminated).
+			std::uint32_t version; ///< See `CastsCacheHeader::currentVersion`.
+			std::uint32_t buildIdSize; ///< Length of the build-id.
+			std::uint64_t tableKey; ///< Identifies which casts table within the library this is.
+			std::uint32_t jsonSize; ///< Length of the JSON, excluding its NUL terminator.
+			std::uint32_t symbolCount; ///< Number of upcast symbols.
+			std::uint64_t totalSize; ///< Size of the whole file.
+
+			static constexpr std::uint32_t currentVersion = 1; ///< The layout version written by this header.
+		};
+
+		/// The contents of a valid cache file.
+		struct CachedCastsTable {
+			std::string json; ///< The JSON casts table.
+			std::vector<std::string> symbols; ///< The symbol of each upcast, or an empty string if it wasn't found.
+		};
+
+		/******************************************************
+		 * Locates, validates, and writes the cache file for one
+		 * casts table. The cache is enabled by setting the
+		 * `CXXFFI_CACHE_DIR` environment variable to an existing,
+		 * writable directory. Any failure (no build-id, a missing,
+		 * truncated, or mismatched file, I/O errors) is treated as
+		 * a cache miss, so the table is always regenerated safely.
+		 ******************************************************/
+		class CastsCache {
+			std::string buildId; ///< The library's build-id as hex, or empty if the cache is disabled.
+			std::uint64_t tableKey; ///< See `CastsCacheHeader::tableKey`.
+			std::string path; ///< The cache file, or empty if the cache is disabled.
+
+		public:
+			/**
+			 * @param addressInImage Any address in the library whose table is cached.
+			 * @param tableKey Distinguishes the casts tables within a single library.
+			 */
+			CastsCache(const void *addressInImage, std::uint64_t tableKey) : tableKey(tableKey) {
+				const char *dir = std::getenv("CXXFFI_CACHE_DIR");
+				if(dir && *dir && loadedImageBuildId(addressInImage, buildId)) {
+					char key[17];
+					std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(tableKey));
+					path = std::string(dir) + "/" + buildId + "-" + key + ".cxxffi";
+				} else {
+					buildId.clear();
+				}
+			}
+
+			/// Whether caching is enabled and possible for this library.
+			bool enabled() const {
+				return !path.empty();
+			}
+
+			/// Map the cache file and validate it, returning its contents if it matches this library and table.
+			std::optional<CachedCastsTable> load() const {
+				if(!enabled()) {
+					return std::nullopt;
+				}
+				int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				if(fd < 0) {
+					return std::nullopt;
+				}
+				struct stat st;
+				if(::fstat(fd, &st) != 0 || std::uint64_t(st.st_size) < sizeof(CastsCacheHeader)) {
+					::close(fd);
+					return std::nullopt;
+				}
+				std::size_t size = st.st_size;
+				void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+				::close(fd);
+				if(mapping == MAP_FAILED) {
+					return std::nullopt;
+				}
+				std::optional<CachedCastsTable> ans = parse(static_cast<const char*>(mapping), size);
+				::munmap(mapping, size);
+				return ans;
+			}
+
+			/// Validate and decode the `size` bytes at `data`.
+			std::optional<CachedCastsTable> parse(const char *data, std::size_t size) const {
+				CastsCacheHeader header;
+				std::memcpy(&header, data, sizeof(header));
+				if(std::memcmp(header.magic, "CXXFFICC", sizeof(header.magic)) != 0 || header.version != CastsCacheHeader::currentVersion
+				   || header.totalSize != size || header.tableKey != tableKey || header.buildIdSize != buildId.size()) {
+					return std::nullopt;
+				}
+				std::size_t offset = sizeof(header);
+				if(size - offset < buildId.size() || buildId.compare(0, std::string::npos, data + offset, buildId.size()) != 0) {
+					return std::nullopt;
+				}
+				offset += buildId.size();
+				if(size - offset <= header.jsonSize || data[offset + header.jsonSize] != '\0') {
+					return std::nullopt;
+				}
+				CachedCastsTable ans;
+				ans.json.assign(data + offset, header.jsonSize);
+				offset += header.jsonSize + 1;
+				ans.symbols.reserve(header.symbolCount);
+				for(std::uint32_t i = 0; i < header.symbolCount; ++i) {
+					const void *end = std::memchr(data + offset, '\0', size - offset);
+					if(!end) {
+						return std::nullopt;
+					}
+					std::size_t length = static_cast<const char*>(end) - (data + offset);
+					ans.symbols.emplace_back(data + offset, length);
+					offset += length + 1;
+				}
+				if(offset != size) {
+					return std::nullopt;
+				}
+				return ans;
+			}
+
+			/// Write `table` to the cache, atomically replacing any existing file. Failures are ignored.
+			void store(const CachedCastsTable &table) const {
+				if(!enabled()) {
+					return;
+				}
+				CastsCacheHeader header = {};
+				std::memcpy(header.magic, "CXXFFICC", sizeof(header.magic));
+				header.version = CastsCacheHeader::currentVersion;
+				header.buildIdSize = buildId.size();
+				header.tableKey = tableKey;
+				header.jsonSize = table.json.size();
+				header.symbolCount = table.symbols.size();
+				std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+				contents += buildId;
+				contents.append(table.json.c_str(), table.json.size() + 1);
+				for(const std::string &symbol : table.symbols) {
+					contents.append(symbol.c_str(), symbol.size() + 1);
+				}
+				header.totalSize = contents.size();
+				std::memcpy(&contents[0], &header, sizeof(header));
+
+				// Write to a private temporary file, then rename it into place, so concurrent readers never see a partial file.
+				std::string temporary = path + "." + std::to_string(::getpid()) + ".tmp";
+				int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+				if(fd < 0) {
+					return;
+				}
+				std::size_t written = 0;
+				while(written < contents.size()) {
+					ssize_t n = ::write(fd, contents.data() + written, contents.size() - written);
+					if(n <= 0) {
+						break;
+					}
+					written += n;
+				}
+				bool ok = written == contents.size();
+				ok = (::close(fd) == 0) && ok;
+				if(!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+					std::remove(temporary.c_str());
+				}
+			}
+		};
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+/************************************************************************************
+ * @file casts_stats.hpp
+ * Timings and counters describing how a casts table was generated, for monitoring
+ * startup cost without rebuilding in debug mode.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+
+namespace CxxFFI {
+	/******************************************************
+	 * Statistics for one casts table, as returned by
+	 * `NAME_stats()`. All fields are `uint64_t`, so the
+	 * equivalent C declaration is obtained by replacing
+	 * `std::uint64_t` with `uint64_t`. Timings are from a
+	 * monotonic clock, in nanoseconds, and are zero for
+	 * phases which haven't run (e.g. because the table
+	 * hasn't been requested yet, or came from the cache).
+	 ******************************************************/
+	struct CastsTableStats {
+		std::uint64_t structSize; ///< `sizeof(CastsTableStats)`, to permit appending fields in later versions.
+		std::uint64_t cacheHit; ///< 1 if the table was loaded from the cache (see `CXXFFI_CACHE_DIR`), otherwise 0.
+		std::uint64_t cacheLoadNs; ///< Time spent looking for and validating a cache file.
+		std::uint64_t symbolLoadNs; ///< Time spent reading the library's symbol table.
+		std::uint64_t demangleNs; ///< Time spent demangling candidate symbols, summed over all scanning threads.
+		std::uint64_t matchNs; ///< Wall time spent matching symbols, including `CastsTableStats::demangleNs`.
+		std::uint64_t mapBuildNs; ///< Time spent building the map of upcast symbols from the matches (or, in registered mode, resolving them).
+		std::uint64_t jsonEmitNs; ///< Time spent generating the JSON casts table.
+		std::uint64_t binaryEmitNs; ///< Time spent generating the binary casts table.
+		std::uint64_t symbolsScanned; ///< Number of symbols examined.
+		std::uint64_t symbolsDemangled; ///< Number of symbols with the mangled prefix of an upcast, which were therefore demangled.
+		std::uint64_t symbolsMatched; ///< Number of symbols recognized as upcasts (between any types, since the scan is shared by every table in the library; see `CxxFFI::Registry`).
+		std::uint64_t castsFound; ///< Number of upcasts in the table whose symbol was found.
+		std::uint64_t castsMissing; ///< Number of upcasts in the table whose symbol wasn't found, and so are omitted from the JSON.
+		std::uint64_t jsonBytes; ///< Size of the JSON casts table, excluding its NUL terminator.
+		std::uint64_t binaryBytes; ///< Size of the binary casts table.
+		std::uint64_t sharedScan; ///< 1 if the library's symbols had already been scanned for another table, in which case the scanning fields above are zero, otherwise 0.
+		std::uint64_t castsShared; ///< Number of upcasts in the table served by a `CxxFFI::upcastByOffset` shared with other upcasts of the same offset. See #CXXFFI_SHARED_UPCAST_LIMIT.
+	};
+
+	static_assert(std::is_standard_layout<CastsTableStats>::value && std::is_trivially_copyable<CastsTableStats>::value, "CastsTableStats must be usable from C");
+
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/// Measures elapsed time on a monotonic clock.
+		class Stopwatch {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		public:
+			/// Nanoseconds since construction.
+			std::uint64_t elapsedNs() const {
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			}
+		};
+
+		/// Thread-safe accumulator for a `CastsTableStats`, since the memoized tables may be generated from different threads.
+		class StatsRecorder {
+			mutable std::mutex mutex;
+			CastsTableStats stats = {sizeof(CastsTableStats)};
+		public:
+			/// Apply `f` to the statistics under the lock.
+			template<typename F> void update(F f) {
+				std::lock_guard<std::mutex> lock(mutex);
+				f(stats);
+			}
+
+			/// A consistent copy of the statistics so far.
+			CastsTableStats snapshot() const {
+				std::lock_guard<std::mutex> lock(mutex);
+				return stats;
+			}
+		};
+
+		/// Counters accumulated by a single scanning thread.
+		struct ScanCounters {
+			std::uint64_t demangled = 0; ///< See `CastsTableStats::symbolsDemangled`.
+			std::uint64_t demangleNs = 0; ///< See `CastsTableStats::demangleNs`.
+		};
+	}
+}
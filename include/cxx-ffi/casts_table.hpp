@@ -25,25 +25,17 @@
 
 #include <boost/dll/library_info.hpp>
 
-#include <boost/mpl/accumulate.hpp>
-#include <boost/mpl/at.hpp>
-#include <boost/mpl/back_inserter.hpp>
-#include <boost/mpl/contains.hpp>
-#include <boost/mpl/copy.hpp>
-#include <boost/mpl/copy_if.hpp>
-#include <boost/mpl/erase_key.hpp>
-#include <boost/mpl/key_type.hpp>
-#include <boost/mpl/pop_front.hpp>
-#include <boost/mpl/push_front.hpp>
-#include <boost/mpl/set.hpp>
-#include <boost/mpl/transform.hpp>
-#include <boost/mpl/vector.hpp>
+#include <boost/mpl/bool.hpp>
 
 #include <boost/preprocessor.hpp>
 
-#include <re2/re2.h>
+#include <dlfcn.h>
 
-#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <iterator>
 
 #ifdef DEBUG
 #include <iostream>
@@ -51,10 +43,61 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <string_view>
+#include <thread>
+#include <tuple>
 #include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include <cxx-ffi/binary_table.hpp>
+#include <cxx-ffi/cast_lookup.hpp>
+#include <cxx-ffi/casts_cache.hpp>
+#include <cxx-ffi/casts_stats.hpp>
+#include <cxx-ffi/image_symbols.hpp>
+#include <cxx-ffi/json_writer.hpp>
+#include <cxx-ffi/name_rewriting.hpp>
 #include <cxx-ffi/refl_base.hpp>
+#include <cxx-ffi/registry.hpp>
+#include <cxx-ffi/subtype_matrix.hpp>
+#include <cxx-ffi/type_intervals.hpp>
+#include <cxx-ffi/type_list.hpp>
+#include <cxx-ffi/type_name.hpp>
+
+/**************************************************************
+ * @def CXXFFI_SCAN_THREADS
+ * The maximum number of threads used to match upcast symbols
+ * in `CastDiscovery::SymbolScan` mode, or 0 to use one per
+ * hardware thread. Only worthwhile for libraries with hundreds
+ * of thousands of symbols; smaller tables are scanned serially
+ * regardless. Defaults to 1 (serial).
+ **************************************************************/
+#ifndef CXXFFI_SCAN_THREADS
+#define CXXFFI_SCAN_THREADS 1
+#endif
+
+/**************************************************************
+ * @def CXXFFI_SHARED_UPCAST_LIMIT
+ * Raw pointer upcasts which are a constant adjustment share one
+ * `CxxFFI::upcastByOffset` (and `CxxFFI::upcastNByOffset`) per
+ * offset, instead of instantiating `CxxFFI::upcast` (and
+ * `CxxFFI::upcastN`) for every pair of types. Offsets aren't
+ * constant expressions, so every offset the base could have is
+ * instantiated, and the right one is chosen when the table is
+ * generated. This bounds the number of possible offsets (the size
+ * of the derived class, in multiples of the base's alignment) for
+ * an upcast to be shared. Defaults to 64; 0 disables sharing.
+ **************************************************************/
+#ifndef CXXFFI_SHARED_UPCAST_LIMIT
+#define CXXFFI_SHARED_UPCAST_LIMIT 64
+#endif
 
 /******************************************************
  * Tools to generate a description of an API's class
@@ -68,37 +111,40 @@ namespace CxxFFI {
 	 * Internal implementation details
 	 **************************************************/
 	namespace detail {
-		using namespace boost::mpl;
-		
-		/// Helper metafunction to concatenate two `boost::mpl::vector`s
-		template<typename Left, typename Right> struct Concatenate {
-			using type = typename copy< Right, back_inserter<Left> >::type;
-		};
-		
 		template<typename Here, typename WIP, typename Done>
 		class VisitBases;
 		
-		/// `boost::mpl`'s convention for metafunctions requires a wrapper struct, see `VisitLooperInner::apply`.
-		struct VisitLoopInner {
-			/// binary metafunction to recurse on `VisitBases` and combine results.
-			template<typename OldState, typename Child> class apply {
-				using Here = typename at<OldState, int_<0>>::type; ///< The class being inspected
-				using OldWIP = typename at<OldState, int_<1>>::type; ///< The `WIP` set before this step.
-				using OldDone = typename at<OldState, int_<2>>::type; ///< The `Done` set before this step.
-				using MaybeTail = typename at<OldState, int_<3>>::type; ///< The suffix of the output sequence known before this step.
-				
-				using VisitBasesThunk = VisitBases<Child, OldWIP, OldDone>; ///< Recursively invoke `VisitBases` on one of `Here`'s base types (amusingly named `Child`).
-				using FinalWIP = typename VisitBasesThunk::FinalWIP; ///< The `WIP` set after this step.
-				using FinalDone = typename VisitBasesThunk::FinalDone; ///< The `Done` set after this step.
-				using MaybeFront = typename VisitBasesThunk::type; ///< Any new prefix for the output after this step.
-				
-				using JoinedList = typename Concatenate<MaybeFront, MaybeTail>::type; ///< Join the known output prefix and suffix.
-			public:
-				using type = vector<Here, FinalWIP, FinalDone, JoinedList>; ///< Rebundle loop state for `boost::mpl::accumulate`.
-				
-			};
+		/****************************************************************************
+		 * Helper metafunction to recurse on `VisitBases` for each of `Children...`
+		 * in turn, threading the `Done` set through, and prepending each result
+		 * to the output.
+		 * @tparam WIP The "work-in-progress" classes with a temporary mark.
+		 * @tparam Done The `Done` set before this step.
+		 * @tparam Tail The suffix of the output sequence known before this step.
+		 * @tparam Children The base classes remaining to be visited (amusingly named).
+		 ****************************************************************************/
+		template<typename WIP, typename Done, typename Tail, typename ...Children> class VisitLoopInner {
+		public:
+			using FinalDone = Done; ///< Nothing has changed.
+			using type = Tail; ///< No updates to the output.
 		};
 		
+		/// Specialization of `VisitLoopInner` which visits `Child`, then proceeds with `Rest...`.
+		template<typename WIP, typename Done, typename Tail, typename Child, typename ...Rest> class VisitLoopInner<WIP, Done, Tail, Child, Rest...> {
+			using VisitBasesThunk = VisitBases<Child, WIP, Done>; ///< Recursively invoke `VisitBases` on one of `Here`'s base types.
+			using JoinedList = Concat<typename VisitBasesThunk::type, Tail>; ///< Join any new output prefix and the known suffix.
+			using NextThunk = VisitLoopInner<WIP, typename VisitBasesThunk::FinalDone, JoinedList, Rest...>; ///< Proceed to the next base class.
+		public:
+			using FinalDone = typename NextThunk::FinalDone; ///< The `Done` set after visiting all of `Child, Rest...`.
+			using type = typename NextThunk::type; ///< The suffix of the output which is fully known after visiting all of `Child, Rest...`.
+		};
+		
+		/// Helper metafunction to unpack the `TypeList` of base classes for `VisitLoopInner`.
+		template<typename WIP, typename Done, typename Bases> class VisitLoopUnpack;
+		
+		/// Implementation of `VisitLoopUnpack`.
+		template<typename WIP, typename Done, typename ...Bases> class VisitLoopUnpack<WIP, Done, TypeList<Bases...>> : public VisitLoopInner<WIP, Done, TypeList<>, Bases...> {};
+		
 		/****************************************************************************
 		 * Helper metafunction that actually implements one step of the DFS.
 		 * @tparam Here The class currently being visited.
@@ -107,39 +153,25 @@ namespace CxxFFI {
 		 * @pre `Here` is not contained in either `WIP` or `Done`.
 		 ****************************************************************************/
 		template<typename Here, typename WIP, typename Done> class VisitLoop {
-			using InitWIP = WIP;
-			using NextWIP = typename insert<InitWIP, Here>::type; ///< Add temporary mark on `Here`
-			using ReflBases = typename ReflBases<Here>::type; ///< Retrieve `Here`s bases to iterate over.
-			/******************************************************************
-			 * Bundle the current state for use with `boost::mpl::accumulate`.
-			 * Elements are `Here`, `VisitLoop::NextWIP`, `Done`, and an
-			 * empty output sequence. 
-			 ******************************************************************/
-			using InitState = vector<Here, NextWIP, Done, vector<>>;
-			
-			using AccumulatedState = typename accumulate<ReflBases, InitState, VisitLoopInner>::type; ///< Execute `VisitLoopInner` over `ReflBases`
-			using AccumulatedWIP = typename at<AccumulatedState, int_<1>>::type; ///< The `WIP` set, post loop over `ReflBases`.
-			using AccumulatedDone = typename at<AccumulatedState, int_<2>>::type;///< The `Done` set, post loop over `ReflBases`.
-			using AccumulatedTail = typename at<AccumulatedState, int_<3>>::type;///< The suffix of the output which is fully known, post loop over `ReflBases`.
+			using NextWIP = PushFront<WIP, Here>; ///< Add temporary mark on `Here`. Since the mark is removed on return, `WIP` is never threaded between siblings.
+			using ReflBases = AsTypeList<typename ReflBases<Here>::type>; ///< Retrieve `Here`s bases to iterate over.
+			using LoopThunk = VisitLoopUnpack<NextWIP, Done, ReflBases>; ///< Execute `VisitLoopInner` over `ReflBases`
 		public:
-			using FinalWIP = typename erase_key<AccumulatedWIP, typename key_type<AccumulatedWIP, Here>::type>::type; ///< Remove temporary mark on `Here`.
-			using FinalDone = typename insert<AccumulatedDone, Here>::type; ///< Set permanent mark on `Here`.
-			using type = typename push_front<AccumulatedTail, Here>::type; ///< Prepend `Here` to the output.
+			using FinalDone = PushFront<typename LoopThunk::FinalDone, Here>; ///< Set permanent mark on `Here`.
+			using type = PushFront<typename LoopThunk::type, Here>; ///< Prepend `Here` to the output.
 		};
 		
 		/// Helper metafunction to detect if work needs to be done at this step, default is for no work at this step.
-		template<typename Here, typename WIP, typename Done, bool done = contains<Done, Here>::type::value> class VisitBasesJointIf {
+		template<typename Here, typename WIP, typename Done, bool done = Contains<Done, Here>> class VisitBasesJointIf {
 		public:
-			using FinalWIP = WIP; ///< Nothing has changed
 			using FinalDone = Done; ///< Nothing has changed
-			using type = vector<>; ///< No updates to the output.
+			using type = TypeList<>; ///< No updates to the output.
 		};
 
 		/// Specialization of `VisitBasesJointIf` for when `Here` is not contained in `Done`
 		template<typename Here, typename WIP, typename Done> class VisitBasesJointIf<Here, WIP, Done, false> {
 			using VisitLoopThunk = VisitLoop<Here, WIP, Done>; ///< Invoke helper metafunction to perform loop over reflected base classes.
 		public:
-			using FinalWIP = typename VisitLoopThunk::FinalWIP; ///< The updated `WIP` set after this step
 			using FinalDone = typename VisitLoopThunk::FinalDone; ///< The updated `Done` set after this step
 			using type = typename VisitLoopThunk::type; ///< The suffix of the output which is fully known after this step.
 		};
@@ -154,10 +186,9 @@ namespace CxxFFI {
 		 **********************************************************************/
 		template<typename Here, typename WIP, typename Done>
 		class VisitBases {
-			static_assert(!contains<WIP, Here>::value, "Cycle while toposorting base classes. Your inheritance is broken");
+			static_assert(!Contains<WIP, Here>, "Cycle while toposorting base classes. Your inheritance is broken");
 			using IfThunk = VisitBasesJointIf<Here, WIP, Done>; ///< Invoke helper metafunction to determine if we have work at this step.
 		public:
-			using FinalWIP = typename IfThunk::FinalWIP; ///< The updated `WIP` set after this step.
 			using FinalDone = typename IfThunk::FinalDone; ///< The updated `Done` set after this step.
 			using type = typename IfThunk::type; ///< The suffix of the output which is fully known after this step.
 		};
@@ -168,14 +199,14 @@ namespace CxxFFI {
 	struct ToposortBases {
 		/// Metafunction to obtain a topological sort over `T`'s base classes via `VisitBases`.
 		template<typename T> class apply {
-			using WIP = boost::mpl::set<>; ///< Initialize an empty `WIP` set.
-			using Done= boost::mpl::set<>; ///< Initialize an empty `Done` set.
+			using WIP = TypeList<>; ///< Initialize an empty `WIP` set.
+			using Done = TypeList<>; ///< Initialize an empty `Done` set.
 		public:
-			using type =typename detail::VisitBases<T, WIP, Done>::type; ///< Perform the sort.
+			using type = typename detail::VisitBases<T, WIP, Done>::type; ///< Perform the sort.
 		};
 	};
 	
-	/// `std::ostream` support for the various supporting datastructures used in converting `CastsTableEntries` to JSON.
+	/// `std::ostream` support for functors which write to a stream, such as `detail::EscapedTypeNames`.
 	template<typename T> auto operator<<(std::ostream& os, const T& t) -> decltype(t(os), os)
 	{
 		t(os);
@@ -183,9 +214,14 @@ namespace CxxFFI {
 	}
 	
 	namespace detail {
-		/// Obtain a human readable name for `T` by demangling the name of its typeid.
-		template<typename T> std::string readableName() {
-			return boost::core::demangle(typeid(T).name());
+		/**************************************************************
+		 * Obtain a human readable name for `T`, memoized. Uses the
+		 * compile-time `TypeName<T>` where it's guaranteed to match the
+		 * demangler, and otherwise demangles the name of `T`'s typeid.
+		 **************************************************************/
+		template<typename T> const std::string& readableName() {
+			static const std::string ans = TypeName<T>::plain ? std::string(TypeName<T>::value) : boost::core::demangle(typeid(T).name());
+			return ans;
 		}
 	}
 	
@@ -203,237 +239,568 @@ namespace CxxFFI {
 		}
 	};
 	
+	namespace detail {
+		/// Obtain the name of `T` as it should appear in the casts table, by applying `NameRewriter<T>` to `readableName<T>()`, memoized.
+		template<typename T> const std::string& apiName() {
+			static const std::string ans = NameRewriter<T>::apply(readableName<T>());
+			return ans;
+		}
+	}
+	
+	namespace detail {
+		/// The names of the template arguments of `T`, each rewritten by its own `NameRewriter`, if `T` is a specialization of a template with only type parameters.
+		template<typename T> struct TemplateArgumentNames {
+			static constexpr std::size_t count = 0; ///< The number of arguments.
+			/// Obtain the rewritten names.
+			static std::array<std::string_view, count> get() {
+				return {};
+			}
+		};
+		
+		/// Implementation of `TemplateArgumentNames` for template specializations.
+		template<template<typename...> class Tmpl, typename ...Args> struct TemplateArgumentNames<Tmpl<Args...>> {
+			static constexpr std::size_t count = sizeof...(Args); ///< The number of arguments, including defaulted ones such as `std::allocator<T>`.
+			/// Obtain the rewritten names.
+			static std::array<std::string_view, count> get() {
+				return {std::string_view(apiName<Args>())...};
+			}
+		};
+	}
+	
 	/***********************************************************************
 	 * A helper functor which client code can use to apply `NameRewriter` to
 	 * type names when they appear as template parameters for a unary template.
 	 ***********************************************************************/
 	template<template<typename Tp> class PType, typename T> struct SimpleTemplateNameRewriter {
-		/// Reusable pre-compiled regular expression to match the (demangled) name of `T` within the (demangled) name of `PType<T>`.
-		static const re2::RE2& simpleTemplateNameRegExp() {
-			static re2::RE2 ans("^([^<]+<\\s*)(" + re2::RE2::QuoteMeta(detail::readableName<T>()) + ")\\s*(>)$");
-			return ans;
-		}
-		
-		/// Apply `NameWriter<T>` to the (demangled) name of `T` as it appears within the (demangled) name of `Ptype<T>`.
-		static std::string apply(std::string name) {
-			std::string innerReplace = NameRewriter<T>::apply(detail::readableName<T>());
-			std::string ret;
-			if( re2::RE2::Extract(name, simpleTemplateNameRegExp(), "\\1" + innerReplace + "\\3", &ret)  ) {
-				return ret;
+		/// Apply `NameWriter<T>` to the (demangled) name of `T` as it appears as the first template argument within the (demangled) name of `Ptype<T>`.
+		static std::string apply(std::string_view name) {
+			// Rewrite `T` first, since that may reuse `rewriter`.
+			std::string_view innerReplace = detail::apiName<T>();
+			detail::TypeNameRewriter& rewriter = detail::typeNameRewriter();
+			if(rewriter.scan(name) && rewriter.scanned().size() && name.substr(rewriter.scanned()[0].begin, rewriter.scanned()[0].end - rewriter.scanned()[0].begin) == detail::readableName<T>()) {
+				return std::string(rewriter.rewrite(name, &innerReplace, 1, false));
 			} else {
 #ifdef DEBUG
 				
 				std::cerr << "Couldn't parse template, but SimpleTemplateNameRewriter is opt-in" << std::endl;
 				abort();
 #else
-				return name;
+				return std::string(name);
 #endif
 			}
 		}
 	};
 	
-	namespace detail {
-		/// Reusable pre-compiled regular expression to match `std::__1` within a demangled type name.
-		static inline const re2::RE2& stdABIFlatteningNameRegExp() {
-			static re2::RE2 ans("^(" + re2::RE2::QuoteMeta("std::__1") + ")(.+)");
-			return ans;
-		}
-	}
-	
-	/// A functor to replace `std::__1` with `std` in the (demangled) name of `T`.
+	/// A functor to replace `std::__1` (or `std::__cxx11`, or `std::__ndk1`) with `std` throughout the (demangled) name of `T`.
 	template<typename T> struct StdABIFlatteningNameRewriter {
 		/// Perform the replacement.
-		static std::string apply(std::string name) {
-			std::string ret;
-			if( re2::RE2::Extract(name, detail::stdABIFlatteningNameRegExp(), "std\\2", &ret ) ) {
-				return ret;
-			} else {
-#ifdef DEBUG
-				std::cerr << "Couldn't parse template, but StdABIFlatteningNameRewriter is opt-in" << std::endl;
-				abort();
-#else
-				return name;
-#endif
-			}
+		static std::string apply(std::string_view name) {
+			return std::string(detail::typeNameRewriter().rewrite(name, nullptr, 0, true));
+		}
+	};
+	
+	/***********************************************************************
+	 * A functor which client code can use as (or within) the `NameRewriter`
+	 * of a template specialization `Tmpl<Args...>`, where `Tmpl` has only type
+	 * parameters. Replaces each template argument in the (demangled) name of `T`
+	 * with its own rewritten name (`detail::apiName<Args>()`), so rewriting
+	 * applies recursively to arbitrarily nested templates, and flattens the
+	 * inline ABI namespaces of the standard library as `StdABIFlatteningNameRewriter`
+	 * does. Names whose arguments can't be matched up are only flattened.
+	 ***********************************************************************/
+	template<typename T> struct TemplateNameRewriter {
+		/// Perform the rewriting.
+		static std::string apply(std::string_view name) {
+			using Arguments = detail::TemplateArgumentNames<T>;
+			// Rewrite the arguments first, since that may reuse `rewriter`.
+			std::array<std::string_view, Arguments::count> replacements = Arguments::get();
+			detail::TypeNameRewriter& rewriter = detail::typeNameRewriter();
+			bool matched = rewriter.scan(name) && rewriter.scanned().size() == Arguments::count;
+			return std::string(rewriter.rewrite(name, replacements.data(), matched ? Arguments::count : 0, true));
 		}
 	};
 	
-	/// `NameRewriter` specialization for `std::shared_ptr<T>`. Applies both `StdABIFlatteningNameRewriter` and `SimpleTemplateNameRewriter`.
-	template<typename T> struct NameRewriter<std::shared_ptr<T>> {
+	/// `NameRewriter` specialization for `std::shared_ptr<T>`. Rewrites `T`, and flattens inline ABI namespaces, via `TemplateNameRewriter`.
+	template<typename T> struct NameRewriter<std::shared_ptr<T>> : TemplateNameRewriter<std::shared_ptr<T>> {
 		using FullT = std::shared_ptr<T>;
-		static std::string apply(std::string name) {
-			return StdABIFlatteningNameRewriter<std::shared_ptr<T>>::apply(SimpleTemplateNameRewriter<std::shared_ptr, T>::apply(name));
+	};
+	
+	/// `NameRewriter` specialization for `std::unique_ptr<T>`. Rewrites `T` via `TemplateNameRewriter`, and then omits the default deleter, giving `std::unique_ptr<T>`.
+	template<typename T> struct NameRewriter<std::unique_ptr<T>> {
+		using FullT = std::unique_ptr<T>;
+		
+		/// Perform the rewriting.
+		static std::string apply(std::string_view name) {
+			std::string ans = TemplateNameRewriter<FullT>::apply(name);
+			detail::TypeNameRewriter& rewriter = detail::typeNameRewriter();
+			if(rewriter.scan(ans) && rewriter.scanned().size() == 2) {
+				std::size_t end = rewriter.scanned()[0].end;
+				ans.erase(end, ans.find_first_not_of(' ', rewriter.scanned()[1].end) - end);
+			}
+			return ans;
 		}
 	};
 	
+	/// `NameRewriter` specialization for `boost::intrusive_ptr<T>`, via `TemplateNameRewriter`.
+	template<typename T> struct NameRewriter<boost::intrusive_ptr<T>> : TemplateNameRewriter<boost::intrusive_ptr<T>> {
+		using FullT = boost::intrusive_ptr<T>;
+	};
+	
 	namespace detail {
-		using namespace boost::mpl;
+		/****************************************************************
+		 * Describes a single `CxxFFI::upcast` instantiation whose address
+		 * is known at compile time, for use when `CastsTable` is in
+		 * `CastDiscovery::Registered` mode.
+		 ****************************************************************/
+		struct UpcastDescriptor {
+			const std::type_info *derived; ///< Identifies the derived class.
+			const std::type_info *base; ///< Identifies the base class.
+			const std::string& (*derivedName)(); ///< Obtains the (demangled) name of the derived class.
+			const std::string& (*baseName)(); ///< Obtains the (demangled) name of the base class.
+			const std::string& (*baseApiName)(); ///< Obtains the name of the base class as it appears in the casts table.
+			void (*fn)(); ///< Type-erased pointer to `CxxFFI::upcast<Derived, Base>`.
+			void (*inPlaceFn)(); ///< Type-erased pointer to `CxxFFI::upcastInto<Derived, Base>`, or `nullptr` if `Base` isn't a handle type.
+			void (*batchFn)(); ///< Type-erased pointer to `CxxFFI::upcastN<Derived, Base>`.
+			void (*downFn)(); ///< Type-erased pointer to `CxxFFI::downcast<Base, Derived>` for this table, or `nullptr` if `Base` isn't polymorphic.
+			bool intervalDowncast; ///< Whether `UpcastDescriptor::downFn` can decide subtyping by interval numbering. See `CastDowncastByInterval`.
+			bool retypesInPlace; ///< Whether the casts reuse the storage of their argument, i.e. both types are `CovariantHandle`s. See `CastRetypesInPlace`.
+			bool shared; ///< Whether `UpcastDescriptor::fn` and `UpcastDescriptor::batchFn` are shared by every upcast with the same offset, i.e. `detail::IsSharedUpcast` holds, so their symbols aren't those of `CxxFFI::upcast`.
+			bool constantOffset; ///< Whether the upcast is a constant pointer adjustment, i.e. `detail::IsNonVirtualBase` holds.
+			std::ptrdiff_t offset; ///< The adjustment, if `UpcastDescriptor::constantOffset`.
+		};
 		
-		/// Return an empty string if the `boost::mpl` metaiterators `Start` and `End` are equivalent, or `sep` otherwise.
-		template<typename Start, typename End> std::string maybeSeparator(std::string sep = ", ") {
-			return std::is_same<Start, End>::value ? "" : sep;
-		}
+		/// Describes a single class appearing in the casts table.
+		struct TypeDescriptor {
+			const std::type_info *type; ///< Identifies the class.
+			const std::string& (*name)(); ///< Obtains the (demangled) name of the class.
+			const std::string& (*apiName)(); ///< Obtains the name of the class as it appears in the casts table.
+			std::size_t size; ///< `sizeof` the class.
+			std::size_t align; ///< `alignof` the class.
+			void (*destroyFn)(); ///< Type-erased pointer to `CxxFFI::destroy<T>`, or `nullptr` if the class isn't a handle type.
+			const std::type_info *element; ///< Identifies the class a pointer to this class refers to. See `detail::ElementType`.
+			bool handle; ///< Whether the class is a handle type. See `detail::IsHandle`.
+			bool singleChain; ///< Whether `detail::IsSingleChain` holds for the class.
+			std::size_t upcastCount; ///< The number of upcasts from the class, which follow those of the previous class in `HierarchyDescription::upcasts`.
+		};
 		
 		/****************************************************************
-		 * Recursive functor to emit the value associated with JSON
-		 * key-value pair represented by a `CastsTableEntry`. 
-		 * @tparam Derived The class whose base classes we are traversing.
-		 * @tparam Start The base-class metaiterator we are starting from.
-		 * @tparam End The past-the-end base-class metaiterator.
+		 * Runtime description of a `CastsTable::HierarchyFiltered`.
+		 * `HierarchyDescription::upcasts` is grouped by derived class, 
+		 * in the same order as `HierarchyDescription::types`.
 		 ****************************************************************/
-		template<typename Derived, typename Start, typename End> struct CastsTableSubEntries {
-			using Here = typename deref<Start>::type; ///< Dereference `Start` to base class to be inspected at this step.
-			using Next = typename next<Start>::type; ///< Advance `Start` to obtain metaiterator for next recursive step.
-			using CastFunc = Here*(*)(Derived*); ///< A pointer to a function casting from `Derived` to `Here` must have this form.
+		struct HierarchyDescription {
+			std::vector<TypeDescriptor> types; ///< Every class in the casts table, in the order they appear.
+			std::vector<UpcastDescriptor> upcasts; ///< Every upcast in the casts table.
+		};
+		
+		/// The position of each class of a `HierarchyDescription`, so that one class's upcasts can be found without walking the others.
+		struct TypePositions {
+			std::unordered_map<std::string_view, std::size_t> types; ///< The index of each class in `HierarchyDescription::types`, keyed by its API name.
+			std::vector<std::size_t> firstUpcasts; ///< The index in `HierarchyDescription::upcasts` of the first upcast from each class.
 			
-			std::string &derivedName; ///< The demangled name of `Derived`.
-			std::map<std::string, std::string> &knownCasts; ///< Map from demangled base class names to the symbols implementing upcasts from `Derived` to that base class.
-			/****************************************************************
-			 * Emit the JSON for a single base class and its associated upcast, 
-			 * then recursively invoke `CastsTableSubEntries::operator()` for
-			 * the next base class, if any. Together these form a JSON array,
-			 * which is the value associated with the key for `Derived`.
-			 ****************************************************************/
-			std::ostream& operator()(std::ostream& o) const {
-				/************************************************
-				 * The following two lines are cursed. 
-				 * A better language lawyer than I may be able to 
-				 * determine if we can replace `__attribute__((used))`
-				 * with a `volatile` upfront and at least be
-				 * more portably and standards-compliantly cursed
-				 ************************************************/
-				static constexpr const CastFunc instantiateMe __attribute__((used)) = &upcast<Derived, Here>;
-				static_assert(instantiateMe != nullptr, "The compiler is optimizing badly");
-				std::string baseName = readableName<Here>();
-				std::string castSymbol = knownCasts[baseName];
-				if (castSymbol.length()) {
-					o << "\n\t\t" << std::quoted(NameRewriter<Here>::apply(baseName)) << " : " << std::quoted(castSymbol) << maybeSeparator<Next, End>();
+			/// Index the classes of `description`.
+			explicit TypePositions(const HierarchyDescription& description) {
+				std::size_t upcast = 0;
+				for(std::size_t i = 0; i < description.types.size(); ++i) {
+					types.emplace(description.types[i].apiName(), i);
+					firstUpcasts.push_back(upcast);
+					upcast += description.types[i].upcastCount;
 				}
-#ifdef DEBUG
-				else {
-					std::cerr << "Warning: couldn't find upcast from " << derivedName << " to " << baseName << std::endl;
-				}
-#endif
-				return o << CastsTableSubEntries<Derived, Next, End>{derivedName, knownCasts};
 			}
 		};
-
-		/// past-the-end specialization of `CastsTableSubEntries` (i.e. the recursive base case).
-		template<typename Derived, typename End> struct CastsTableSubEntries<Derived, End, End> {
-			std::string &derivedName;
-			std::map<std::string, std::string> &knownCasts;
-			/// Do nothing
-			std::ostream& operator()(std::ostream& o) const {
-				return o;
+		
+		/// A fixed number of strings, each generated at most once, when first requested, from any thread.
+		class LazyStrings {
+			std::unique_ptr<std::once_flag[]> generated; ///< Guards each string.
+			std::vector<std::string> strings; ///< The strings, empty until generated.
+		public:
+			explicit LazyStrings(std::size_t count) : generated(new std::once_flag[count]), strings(count) {}
+			
+			/// Obtain string `i`, generating it with `gen()` if this is the first request.
+			template<typename Gen> const std::string& get(std::size_t i, Gen gen) {
+				std::call_once(generated[i], [&]() {
+					strings[i] = gen();
+				});
+				return strings[i];
 			}
 		};
 		
+		/**************************************************
+		 * Whether `upcast<Derived, Base>` is replaced by the
+		 * `upcastByOffset` for its offset. The base subobject
+		 * lies within `Derived`, at a multiple of its alignment,
+		 * so it has `sizeof(Derived) / alignof(Base)` possible
+		 * offsets, which mustn't exceed #CXXFFI_SHARED_UPCAST_LIMIT.
+		 **************************************************/
+		template<typename Derived, typename Base> struct IsSharedUpcast
+		: std::bool_constant<IsNonVirtualBase<Derived, Base>::value && sizeof(Derived) / alignof(Base) <= CXXFFI_SHARED_UPCAST_LIMIT> {};
+		
+		/// The `upcastByOffset` and `upcastNByOffset` for `offset`, among the possible offsets `Is * Align...` of a base aligned to `Align`.
+		template<std::size_t Align, std::size_t ...Is> std::pair<void (*)(), void (*)()> sharedUpcast(std::ptrdiff_t offset, std::index_sequence<Is...>) {
+			static constexpr void* (*const singles[])(void*) = {&upcastByOffset<Is * Align>...};
+			static constexpr void (*const batches[])(void* const*, void**, std::size_t) = {&upcastNByOffset<Is * Align>...};
+			return {reinterpret_cast<void (*)()>(singles[offset / Align]), reinterpret_cast<void (*)()>(batches[offset / Align])};
+		}
+		
+		/// Obtain the `UpcastDescriptor` for `upcast<Derived, Base>`, and its inverse `downcast<Base, Derived, Index>`.
+		template<typename Derived, typename Base, typename Index> UpcastDescriptor describeUpcast() {
+			using CastFunc = Base*(*)(Derived*); ///< A pointer to a function casting from `Derived` to `Base` must have this form.
+			using BatchFunc = void(*)(Derived* const*, Base**, std::size_t); ///< A pointer to a function casting arrays from `Derived` to `Base` must have this form.
+			void (*fn)() = nullptr;
+			void (*batchFn)() = nullptr;
+			void (*inPlaceFn)() = nullptr;
+			bool constantOffset = false;
+			std::ptrdiff_t offset = 0;
+			if constexpr (IsNonVirtualBase<Derived, Base>::value) {
+				constantOffset = true;
+				offset = baseOffset<Derived, Base>();
+			}
+			// Only instantiate `upcast` and `upcastN` for this pair if they can't be shared.
+			if constexpr (IsSharedUpcast<Derived, Base>::value) {
+				std::tie(fn, batchFn) = sharedUpcast<alignof(Base)>(offset, std::make_index_sequence<sizeof(Derived) / alignof(Base)>());
+			} else {
+				static constexpr const CastFunc castFunc = &upcast<Derived, Base>;
+				static constexpr const BatchFunc batchFunc = &upcastN<Derived, Base>;
+				fn = reinterpret_cast<void(*)()>(castFunc);
+				batchFn = reinterpret_cast<void(*)()>(batchFunc);
+			}
+			if constexpr (IsHandle<Base>::value) {
+				using InPlaceFunc = Base*(*)(Derived*, void*); ///< A pointer to a function casting from `Derived` to `Base` in place must have this form.
+				static constexpr const InPlaceFunc inPlaceFunc = &upcastInto<Derived, Base>;
+				inPlaceFn = reinterpret_cast<void(*)()>(inPlaceFunc);
+			}
+			void (*downFn)() = nullptr;
+			bool intervalDowncast = false;
+			if constexpr (IsCheckedDowncast<Base, Derived>::value) {
+				using DownFunc = Derived*(*)(Base*); ///< A pointer to a function casting from `Base` to `Derived` must have this form.
+				static constexpr const DownFunc downFunc = &downcast<Base, Derived, Index>;
+				downFn = reinterpret_cast<void(*)()>(downFunc);
+				intervalDowncast = IsNonVirtualBase<typename ElementType<Derived>::type, typename ElementType<Base>::type>::value && IsSingleChain<Derived>::value;
+			}
+			return {&typeid(Derived), &typeid(Base), &readableName<Derived>, &readableName<Base>, &apiName<Base>, fn, inPlaceFn, batchFn, downFn, intervalDowncast, CovariantHandle<Derived>::value && CovariantHandle<Base>::value, IsSharedUpcast<Derived, Base>::value, constantOffset, offset};
+		}
+		
+		/// Obtain the `TypeDescriptor` for `T`, which has `upcastCount` upcasts.
+		template<typename T> TypeDescriptor describeType(std::size_t upcastCount) {
+			void (*destroyFn)() = nullptr;
+			if constexpr (IsHandle<T>::value) {
+				using DestroyFunc = void(*)(T*); ///< `CxxFFI::destroy<T>` must have this form.
+				static constexpr const DestroyFunc destroyFunc = &destroy<T>;
+				destroyFn = reinterpret_cast<void(*)()>(destroyFunc);
+			}
+			return {&typeid(T), &readableName<T>, &apiName<T>, sizeof(T), alignof(T), destroyFn, &typeid(typename ElementType<T>::type), IsHandle<T>::value, IsSingleChain<T>::value, upcastCount};
+		}
+		
 		/****************************************************************
-		 * Functor to emit the JSON key-value pair for
-		 * inheritance hierarchy in `TopoSorted`.
-		 * @tparam TopoSorted A `boost::mpl::vector` containing a single
-		 * inheritance hierarchy, sorted from most-derived to least-derived.
+		 * A functor to record the `TypeDescriptor`s and `UpcastDescriptor`s
+		 * for the inheritance hierarchy of all discovered classes in the API.
+		 * @tparam Hierarchies A `TypeList` of toposorted hierarchies.
+		 * @tparam Index The `CastsTable` whose interval numbering the downcasts use.
 		 ****************************************************************/
-		template<typename TopoSorted> struct CastsTableEntry {
-			using Derived = typename at<TopoSorted, int_<0>>::type; ///< The most derived class will be the key for our key-value pair.
-			using Bases = typename pop_front<TopoSorted>::type; ///< All known base classes `Derived`, as discovered via `ToposortBases`.
-			using Begin = typename begin<Bases>::type; ///< Metaiterator to the beginning of `Bases`.
-			using End = typename end<Bases>::type; ///< Metaiterator past-the-end of `Bases`.
-			std::map<std::string, std::map<std::string, std::string> > &knownCasts; ///< See `CastsTableEntries::knownCasts`.
-			/// Actually emit the key-value pair for this `CastsTableEntry`.
-			std::ostream& operator()(std::ostream& o) const {
-				std::string derivedName = readableName<Derived>();
-				return o << "\n\t" << "" << std::quoted(NameRewriter<Derived>::apply(derivedName)) << " : {" << CastsTableSubEntries<Derived, Begin, End>{derivedName, knownCasts[derivedName]} << "}" ;
+		template<typename Hierarchies, typename Index> struct RegisterUpcasts;
+		
+		/// Implementation of `RegisterUpcasts`.
+		template<typename ...Hierarchies, typename Index> struct RegisterUpcasts<TypeList<Hierarchies...>, Index> {
+			/// Record the most derived class of a single hierarchy, and its upcasts to each of `Bases...`.
+			template<typename Derived, typename ...Bases> static void registerOne(HierarchyDescription& description, TypeList<Derived, Bases...>) {
+				description.types.push_back(describeType<Derived>(sizeof...(Bases)));
+				(description.upcasts.push_back(describeUpcast<Derived, Bases, Index>()), ...);
+			}
+			
+			/// Record every hierarchy in `Hierarchies...`, in order.
+			void operator()(HierarchyDescription& description) const {
+				(registerOne(description, Hierarchies()), ...);
 			}
 		};
 		
 		/****************************************************************
-		 * A recursive functor to emit the JSON key-value pair for
-		 * inheritance hierarchy of all discovered classes in the API.
-		 * @tparam Start Metaiterator defining start of current recursive step
-		 * @tparam End Metaiterator past-the-end of current recursive step.
+		 * Emit the JSON object for the upcasts `[upcast, end)` of one
+		 * class to `sink` (see `detail::writeJson`), mapping the names of
+		 * its bases to the symbols of the upcasts, and omitting upcasts
+		 * whose symbol is empty.
+		 * @param symbolOf Returns the symbol of an `UpcastDescriptor`, as
+		 * anything convertible to `std::string_view`, without allocating.
 		 ****************************************************************/
-		template<typename Start, typename End> struct CastsTableEntries {
-			using Here = typename deref<Start>::type; ///< The most-derived class in the inheritance hierarchy to emit at this step.
-			using Next = typename next<Start>::type; ///< Metaiterator defining start of next recursive step.
-			
-			/***************************************************************
-			 * A map from all discovered API classes to a map from their base
-			 * classes to the (demangled) symbol names for the upcasts between
-			 * a discovered class and the given base.
-			 * 
-			 * In other words, `knownCasts["B"]["A"]` would return the (demangled)
-			 * name of the symbol for `CxxFFI::upcast<B,A>`.
-			 ***************************************************************/
-			std::map<std::string, std::map<std::string, std::string> > &knownCasts;
-
-			/// Invoke `CastsTableEntry<Here>`, then proceed with recursion.
-			std::ostream& operator()(std::ostream& o) const {
-				return o << CastsTableEntry<Here>{knownCasts} << maybeSeparator<Next, End>() << CastsTableEntries<Next, End>{knownCasts};
+		template<typename Sink, typename SymbolOf> void emitUpcasts(Sink& sink, const UpcastDescriptor *upcast, const UpcastDescriptor *end, SymbolOf symbolOf) {
+			sink.raw("{");
+			for(; upcast != end; ++upcast) {
+				std::string_view symbol = symbolOf(*upcast);
+				if(symbol.length()) {
+					sink.raw("\n\t\t");
+					sink.quoted(upcast->baseApiName());
+					sink.raw(" : ");
+					sink.quoted(symbol);
+					// For compatibility, the separator depends on whether any upcasts follow, not whether they will be emitted.
+					if(upcast + 1 != end) {
+						sink.raw(", ");
+					}
+				}
+#ifdef DEBUG
+				else {
+					std::cerr << "Warning: couldn't find upcast from " << upcast->derivedName() << " to " << upcast->baseName() << std::endl;
+				}
+#endif
 			}
-		};
+			sink.raw("}");
+		}
 		
-		/// Past-the-end specialization of `CastsTableEntries` (i.e. the recursive base case).
-		template<typename End> struct CastsTableEntries<End, End> {
-			std::map<std::string, std::map<std::string, std::string> > &knownCasts; ///< See `CastsTableEntries::knownCasts`.
-			/// Do nothing;
-			std::ostream& operator()(std::ostream& o) const {
-				return o;
+		/****************************************************************
+		 * Emit the JSON casts table for `description` to `sink` (see
+		 * `detail::writeJson`): an object mapping the name of each class
+		 * to its object from `detail::emitUpcasts`.
+		 * @param symbolOf As for `detail::emitUpcasts`.
+		 ****************************************************************/
+		template<typename Sink, typename SymbolOf> void emitCastsTable(Sink& sink, const HierarchyDescription& description, SymbolOf symbolOf) {
+			sink.raw("{");
+			const UpcastDescriptor *upcast = description.upcasts.data();
+			for(std::size_t i = 0; i < description.types.size(); ++i) {
+				const TypeDescriptor& type = description.types[i];
+				sink.raw("\n\t");
+				sink.quoted(type.apiName());
+				sink.raw(" : ");
+				emitUpcasts(sink, upcast, upcast + type.upcastCount, symbolOf);
+				upcast += type.upcastCount;
+				if(i + 1 != description.types.size()) {
+					sink.raw(", ");
+				}
 			}
-		};
+			sink.raw("}");
+		}
+		
+		/****************************************************************
+		 * Resolve the exported symbol name of a function in a loaded 
+		 * image via `dladdr`, without touching the library's file.
+		 * @return The symbol name, which remains valid while the image is
+		 * loaded, or `nullptr` if the function isn't visible in the
+		 * dynamic symbol table.
+		 ****************************************************************/
+		inline const char* resolveSymbolName(void (*fn)()) {
+			Dl_info info;
+			void *addr = reinterpret_cast<void*>(fn);
+			if(dladdr(addr, &info) && info.dli_sname && info.dli_saddr == addr) {
+				return info.dli_sname;
+			} else {
+				return nullptr;
+			}
+		}
+		
+		/// As `detail::resolveSymbolName`, but returning an empty string if the function isn't visible.
+		inline std::string resolveSymbol(void (*fn)()) {
+			const char *name = resolveSymbolName(fn);
+			return name ? name : "";
+		}
 		
 		/// `boost::mpl`'s convention for metafunctions requires a wrapper struct, see `Vect2Set::apply`.
 		struct Vec2Set {
-			/// Convert a `boost::mpl::vector` to a `boost::mpl::set`.
+			/// Convert a `TypeList` to a set, discarding duplicates.
 			template<typename Vec> struct apply {
-				using type = typename fold<Vec, set0<>, insert<_1,_2>>::type;
+				using type = ToSet<Vec>;
 			};
 		};
 		
 		/// `boost::mpl`'s convention for metafunctions requires a wrapper struct, see `SetUnion::apply`.
 		struct SetUnion {
-			/// Take the union of two `boost::mpl::set`s.
+			/// Take the union of two sets.
 			template<typename left, typename right> struct apply {
-				using type = typename copy<right, inserter<left, insert<_1, _2>>>::type;
+				using type = CxxFFI::SetUnion<left, right>;
 			};
 		};
 		
 		/****************************************************************
-		 * A recursive functor to generate a regular expression matching
+		 * A functor to generate a regular expression matching
 		 * the demangled names of all discovered types in the API.
-		 * @tparam Start Metaiterator defining start of current recursive step
-		 * @tparam End Metaiterator past-the-end of current recursive step.
+		 * @tparam KnownTypes A `TypeList` of the types to match.
 		 ****************************************************************/
-		template<typename Start, typename End> struct EscapedTypeNames {
-			using Here = typename deref<Start>::type; ///< The class to be added to the regex this step.
-			using Next = typename next<Start>::type; ///< The metaiterator defining start of next recursive step.
-			/// Quote the (demangled) name of `Here`, ensuring any regex special characters are escaped, then proceed to next recursive step.
-			std::ostream& operator()(std::ostream& o) const {
-				return o << "(?:" << re2::RE2::QuoteMeta(readableName<Here>()) << ")" << maybeSeparator<Next,End>("|") << EscapedTypeNames<Next, End>();
+		template<typename KnownTypes> struct EscapedTypeNames;
+		
+		/// Write `s` to `o`, escaping any regex special characters exactly as `RE2::QuoteMeta` would.
+		inline std::ostream& quoteRegex(std::ostream& o, std::string_view s) {
+			for(char c : s) {
+				if(c == '\0') {
+					o << "\\x00";
+				} else {
+					bool word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+					if(!word && !(c & 0x80)) {
+						o << '\\';
+					}
+					o << c;
+				}
 			}
-		};
+			return o;
+		}
 		
-		/// Past-the-end specialization of `EscapedTypeNames` (aka the recursive base-case).
-		template<typename End> struct EscapedTypeNames<End, End> {
-			/// Do nothing
+		/// Implementation of `EscapedTypeNames`.
+		template<typename ...KnownTypes> struct EscapedTypeNames<TypeList<KnownTypes...>> {
+			/// Quote the (demangled) name of each type, ensuring any regex special characters are escaped, and join them as alternatives.
 			std::ostream& operator()(std::ostream& o) const {
+				const char* sep = "";
+				((quoteRegex(o << sep << "(?:", readableName<KnownTypes>()) << ")", sep = "|"), ...);
 				return o;
 			}
 		};
 		
 		/// A functor generating a regular expression matching all discovered API types.
 		template<typename KnownTypes> struct MatchKnownTypes {
-			using Begin = typename begin<KnownTypes>::type; ///< Metaiterator to the beginning of `KnownTypes`.
-			using End = typename end<KnownTypes>::type; ///< Metaiterator past-the-end of `KnownTypes`.
-
 			/// Invoke `EscapedTypeNames` and slam the whole alternation of names together into a capture group
 			static std::string apply() {
 				std::ostringstream o;
-				o << "(" << EscapedTypeNames<Begin, End>() << ")";
+				o << "(" << EscapedTypeNames<KnownTypes>() << ")";
 				return o.str();
 			};
 		};
 		
+		/****************************************************************
+		 * Recognizes the symbols of `CxxFFI::upcast` instantiations
+		 * between known types. Symbols are first rejected by their
+		 * mangled prefix, so only the few survivors are demangled. Their
+		 * template arguments are then split structurally and looked up
+		 * in a hash set, so the cost is linear in the number of symbols
+		 * and independent of the number of known types.
+		 ****************************************************************/
+		class UpcastSymbolMatcher {
+			std::unordered_set<std::string> known; ///< The demangled names of the known types.
+			bool anyType = false; ///< Whether every type is known, see `UpcastSymbolMatcher::addAllTypes`.
+			
+			/// Trim leading and trailing whitespace from `s`.
+			static std::string_view trim(std::string_view s) {
+				std::size_t start = s.find_first_not_of(" \t");
+				if(start == std::string_view::npos) {
+					return std::string_view();
+				}
+				return s.substr(start, s.find_last_not_of(" \t") + 1 - start);
+			}
+			
+		public:
+			/// The mangled prefix of every `CxxFFI::upcast` instantiation in the Itanium ABI, i.e. `CxxFFI::upcast<`.
+			static constexpr std::string_view mangledPrefix = "_ZN6CxxFFI6upcastI";
+			
+			/// Add the demangled name of a known type.
+			void addType(const std::string& name) {
+				known.insert(name);
+			}
+			
+			/// Treat every type as known, so as to match every upcast.
+			void addAllTypes() {
+				anyType = true;
+			}
+			
+			/****************************************************************
+			 * Test whether `symbol` names `Base* CxxFFI::upcast<Derived, Base>(Derived*)`
+			 * for known types `Derived` and `Base`, and if so, extract their names.
+			 * Demangling is tallied in `counters`, if provided.
+			 ****************************************************************/
+			bool match(const std::string& symbol, std::string& derived, std::string& base, ScanCounters *counters = nullptr) const {
+				if(symbol.compare(0, mangledPrefix.size(), mangledPrefix) != 0) {
+					return false;
+				}
+				Stopwatch demangling;
+				std::string readable(boost::core::demangle(symbol.c_str()));
+				if(counters) {
+					++counters->demangled;
+					counters->demangleNs += demangling.elapsedNs();
+				}
+				constexpr std::string_view marker = "CxxFFI::upcast<";
+				std::size_t open = readable.find(marker);
+				if(open == std::string::npos) {
+					return false;
+				}
+				// Split the template arguments at the top-level comma, and find the matching close bracket.
+				std::size_t argsStart = open + marker.size(), comma = std::string::npos, close = std::string::npos;
+				int depth = 0;
+				for(std::size_t i = argsStart; i < readable.size() && close == std::string::npos; ++i) {
+					switch(readable[i]) {
+						case '<': case '(': case '[': ++depth; break;
+						case ')': case ']': --depth; break;
+						case '>':
+							if(depth) {
+								--depth;
+							} else {
+								close = i;
+							}
+							break;
+						case ',':
+							if(!depth && comma == std::string::npos) {
+								comma = i;
+							}
+							break;
+					}
+				}
+				if(comma == std::string::npos || close == std::string::npos) {
+					return false;
+				}
+				std::string_view view(readable);
+				std::string_view derivedView = trim(view.substr(argsStart, comma - argsStart));
+				std::string_view baseView = trim(view.substr(comma + 1, close - comma - 1));
+				// The return type and parameter must agree with the template arguments.
+				std::string_view returnType = trim(view.substr(0, open));
+				std::string_view parameter = view.substr(close + 1);
+				if(returnType.size() != baseView.size() + 1 || returnType.substr(0, baseView.size()) != baseView || returnType.back() != '*'
+				   || parameter.size() != derivedView.size() + 3 || parameter.front() != '(' || parameter.substr(1, derivedView.size()) != derivedView || parameter.substr(derivedView.size() + 1) != "*)") {
+					return false;
+				}
+				derived.assign(derivedView);
+				base.assign(baseView);
+				return anyType || (known.count(derived) && known.count(base));
+			}
+		};
+		
+		/// An upcast symbol recognized by `UpcastSymbolMatcher`.
+		struct UpcastSymbolMatch {
+			const std::string *symbol; ///< The (mangled) symbol.
+			std::string derived; ///< The demangled name of the derived class.
+			std::string base; ///< The demangled name of the base class.
+		};
+		
+		/// Apply `matcher` to `exports[begin, end)`, appending any matches to `out` in order, and tallying demangling in `counters`.
+		inline void matchUpcastSymbols(const UpcastSymbolMatcher& matcher, const std::vector<std::string>& exports, std::size_t begin, std::size_t end, std::vector<UpcastSymbolMatch>& out, ScanCounters& counters) {
+			std::string derived, base;
+			for(std::size_t i = begin; i < end; ++i) {
+				if(matcher.match(exports[i], derived, base, &counters)) {
+					out.push_back({&exports[i], derived, base});
+				}
+			}
+		}
+		
+		/****************************************************************
+		 * Recognize the upcasts in `exports`, partitioning it into
+		 * contiguous chunks across up to `threads` threads. Matches are
+		 * merged in chunk order, so the result is identical to a serial
+		 * scan regardless of `threads`.
+		 * @param threads The maximum number of threads, or 0 for 
+		 * `std::thread::hardware_concurrency()`.
+		 * @param minChunk The fewest symbols worth handing to a thread.
+		 * @param counters If provided, accumulates the counters from every thread.
+		 ****************************************************************/
+		inline std::vector<UpcastSymbolMatch> scanUpcastSymbols(const UpcastSymbolMatcher& matcher, const std::vector<std::string>& exports, unsigned threads, std::size_t minChunk = 1 << 14, ScanCounters *counters = nullptr) {
+			if(!threads) {
+				threads = std::max(1u, std::thread::hardware_concurrency());
+			}
+			std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(threads, exports.size() / std::max<std::size_t>(minChunk, 1)));
+			std::vector<std::vector<UpcastSymbolMatch>> matches(chunks);
+			std::vector<ScanCounters> chunkCounters(chunks);
+			std::vector<std::thread> workers;
+			std::size_t chunkSize = (exports.size() + chunks - 1) / chunks;
+			// The calling thread takes the first chunk itself.
+			for(std::size_t chunk = 1; chunk < chunks; ++chunk) {
+				std::size_t begin = std::min(chunk * chunkSize, exports.size()), end = std::min(begin + chunkSize, exports.size());
+				workers.emplace_back(matchUpcastSymbols, std::cref(matcher), std::cref(exports), begin, end, std::ref(matches[chunk]), std::ref(chunkCounters[chunk]));
+			}
+			matchUpcastSymbols(matcher, exports, 0, std::min(chunkSize, exports.size()), matches[0], chunkCounters[0]);
+			for(std::thread& worker : workers) {
+				worker.join();
+			}
+			for(std::size_t chunk = 1; chunk < chunks; ++chunk) {
+				std::move(matches[chunk].begin(), matches[chunk].end(), std::back_inserter(matches[0]));
+			}
+			if(counters) {
+				for(const ScanCounters& chunk : chunkCounters) {
+					counters->demangled += chunk.demangled;
+					counters->demangleNs += chunk.demangleNs;
+				}
+			}
+			return std::move(matches[0]);
+		}
+		
 		/// Retrieve the symbol table from the `__text` or `.text` section of a shared library.
 		std::vector<std::string> symbolTable(boost::dll::library_info &inf) {
 			std::vector<std::string> exports = inf.symbols("__text");
@@ -456,29 +823,79 @@ namespace CxxFFI {
 		
 		/// `boost::mpl`'s convention for metafunctions requires a wrapper struct, see `FilterUnused::apply`.
 		template<typename SeedTypes> struct FilterUnused {
+			/// Predicate testing if `T` appears in `SeedTypes`.
+			template<typename T> struct IsSeed : std::bool_constant<Contains<SeedTypes, T>> {};
+			
 			/// Remove any types which appear in `Sorted` but don't appear in `SeedTypes`
 			template<typename Sorted> struct apply {
-				using type = typename copy_if<Sorted, contains<SeedTypes, _1> >::type;
+				using type = Filter<IsSeed, Sorted>;
 			};
 		};
 	}
 	
+	namespace detail {
+		/****************************************************************
+		 * Runs a function on a background thread from construction, so
+		 * that as a static it starts when its library is loaded. Its
+		 * destructor joins the thread, so the library can't be unloaded
+		 * (nor the process exit) while it is still running.
+		 ****************************************************************/
+		class BackgroundInit {
+			std::atomic<bool> finished{false}; ///< Whether the function has returned (or thrown).
+			std::thread worker; ///< Runs the function.
+		public:
+			/// Start running `init()` in the background. Exceptions are discarded, leaving the work to be redone (and the exception rethrown) in whichever thread next needs it.
+			explicit BackgroundInit(void (*init)()) : worker([this, init]() {
+				try {
+					init();
+				} catch(...) {
+				}
+				finished.store(true, std::memory_order_release);
+			}) {}
+			
+			BackgroundInit(const BackgroundInit&) = delete;
+			BackgroundInit& operator=(const BackgroundInit&) = delete;
+			
+			~BackgroundInit() {
+				if(worker.joinable()) {
+					worker.join();
+				}
+			}
+			
+			/// Whether the function has finished, without blocking.
+			bool ready() const {
+				return finished.load(std::memory_order_acquire);
+			}
+		};
+	}
+	
+	/// Strategies available to `CastsTable` for discovering the symbol names of upcasts.
+	enum class CastDiscovery {
+		SymbolScan, ///< Demangle and match every symbol in the library's symbol table. See `#CXXFFI_EXPOSE`.
+		Registered ///< Resolve compile-time registered upcast addresses via `dladdr`. See `#CXXFFI_EXPOSE_REGISTERED`.
+	};
+	
 	/*************************************************************************************
 	 * Functor to build a JSON casts table for some set of API-exposed types.
 	 * @tparam libraryLocation The pointed-to function should return a `boost::filesystem::path`
 	 * to a shared library whose symbol table will be examined. See `#CXXFFI_EXPOSE`'s `LOC`
-	 * parameter for more information.
+	 * parameter for more information. Unused (and may be `nullptr`) in `CastDiscovery::Registered` mode.
 	 * @tparam SeedTypes The set of types exposed through the API.
+	 * @tparam discovery How to find the symbols implementing each upcast.
 	 *************************************************************************************/
-	template<boost::filesystem::path(*libraryLocation)(), typename SeedTypes> class CastsTable {
-		/// Transform `SeedTypes` via `ToposortBases` to construct a vector of types. `SeedTypes` may be associative
-		using Hierarchy = typename boost::mpl::transform<SeedTypes, ToposortBases, boost::mpl::back_inserter<boost::mpl::vector0<>>>::type;
+	template<boost::filesystem::path(*libraryLocation)(), typename SeedTypes, CastDiscovery discovery = CastDiscovery::SymbolScan> class CastsTable {
+		/// `SeedTypes` as a `TypeList`. `SeedTypes` may also be any `boost::mpl` sequence, including associative ones.
+		using Seeds = AsTypeList<SeedTypes>;
+		/// Transform `Seeds` via `ToposortBases` to construct a `TypeList` of `TypeList`s.
+		using Hierarchy = Transform<ToposortBases::apply, Seeds>;
 		/// Remove as irrelevant any types which appear in the inheritance hierachies but not the actual exposed API functions.
-		using HierarchyFiltered = typename boost::mpl::transform<Hierarchy, detail::FilterUnused<SeedTypes>>::type;
+		using HierarchyFiltered = Transform<detail::FilterUnused<Seeds>::template apply, Hierarchy>;
 		/// Uniquify the discovered types.
-		using KnownTypes = typename boost::mpl::fold<typename boost::mpl::transform<HierarchyFiltered,detail::Vec2Set>::type, boost::mpl::set0<>, detail::SetUnion>::type;
+		using KnownTypes = UnionAll<Transform<detail::Vec2Set::apply, HierarchyFiltered>>;
 		/// Used to create regular expression for matching the (demangled) name of any element in `KnownTypes`.
 		using MatchKnownTypes = detail::MatchKnownTypes<KnownTypes>;
+		/// The subtype relation between the types of `HierarchyFiltered`, computed at compile time.
+		using SubtypeMatrix = detail::SubtypeMatrix<HierarchyFiltered>;
 		
 		/// Memoize result of `CastsTable::MatchKnownTypes`.
 		static std::string& matchKnownTypes() {
@@ -486,46 +903,222 @@ namespace CxxFFI {
 			return ans;
 		}
 		
-		/// Create a two-level map from derived classes to base classes to upcast symbols. See `CastsTableEntries::knownCasts`.
-		static std::map<std::string, std::map<std::string, std::string> > genKnownCasts() {
-			std::string& knownTypes = matchKnownTypes();
-			// Create a regular expressin matching the (demangled) symbol name for `CxxFFI::upcast` for all known types.
-			std::string matchUpcastSrc = knownTypes + re2::RE2::QuoteMeta("*") + "\\s+" + re2::RE2::QuoteMeta("CxxFFI::upcast<") + knownTypes + re2::RE2::QuoteMeta(",") + "\\s*" + knownTypes + "\\s*" + re2::RE2::QuoteMeta(">(") + knownTypes + re2::RE2::QuoteMeta("*)");
+		/// Memoize the `detail::HierarchyDescription` of `CastsTable::HierarchyFiltered`, including the address of every upcast.
+		static const detail::HierarchyDescription& hierarchyDescription() {
+			static const detail::HierarchyDescription ans = [](){
+				detail::HierarchyDescription description;
+				detail::RegisterUpcasts<HierarchyFiltered, CastsTable>()(description);
+				return description;
+			}();
+			return ans;
+		}
+		
+		/// Create a two-level map from derived classes to base classes to upcast symbols, by resolving the upcasts in `CastsTable::hierarchyDescription`.
+		static std::map<std::string, std::map<std::string, std::string> > genRegisteredCasts() {
+			detail::Stopwatch resolving;
+			std::map<std::string, std::map<std::string, std::string> > knownCasts;
+			for(const detail::UpcastDescriptor& upcast : hierarchyDescription().upcasts) {
+				std::string symbol = detail::resolveSymbol(upcast.fn);
+				if(symbol.length()) {
 #ifdef DEBUG
-			std::cout << "Parsing symbols via " << matchUpcastSrc << std::endl;
+					std::cout << "knownCasts[" << upcast.derivedName() << "][" << upcast.baseName() << "] = " << symbol << std::endl;
 #endif
-			re2::RE2 matchUpcast(matchUpcastSrc);
+					knownCasts[upcast.derivedName()][upcast.baseName()] = symbol;
+				}
+#ifdef DEBUG
+				else {
+					std::cerr << "Registered upcast from " << upcast.derivedName() << " to " << upcast.baseName() << " is not in the dynamic symbol table" << std::endl;
+				}
+#endif
+			}
+			stats().update([&](CastsTableStats& stats) {
+				stats.mapBuildNs = resolving.elapsedNs();
+			});
+			return knownCasts;
+		}
+		
+		/// The statistics for this table, updated as each phase of generation completes.
+		static detail::StatsRecorder& stats() {
+			static detail::StatsRecorder ans;
+			return ans;
+		}
+		
+		/// Any address within the library described by this `CastsTable`.
+		static const void* imageAddress() {
+			if constexpr (libraryLocation != nullptr) {
+				return reinterpret_cast<const void*>(libraryLocation);
+			} else {
+				return reinterpret_cast<const void*>(&CastsTable::apply);
+			}
+		}
+		
+		/// Memoize the `detail::CastsCache` for this table, distinguished from others in the same library by the hash of its mangled type.
+		static const detail::CastsCache& cache() {
+			static const detail::CastsCache ans(imageAddress(), detail::fnv1a(typeid(CastsTable).name()));
+			return ans;
+		}
+		
+		/// Memoize the contents of `CastsTable::cache`, if it is enabled and valid.
+		static const std::optional<detail::CachedCastsTable>& cachedTable() {
+			static const std::optional<detail::CachedCastsTable> ans = []() -> std::optional<detail::CachedCastsTable> {
+				detail::Stopwatch loading;
+				std::optional<detail::CachedCastsTable> cached = cache().load();
+				if(cached && cached->symbols.size() != hierarchyDescription().upcasts.size()) {
+					cached.reset();
+				}
+				stats().update([&](CastsTableStats& stats) {
+					stats.cacheHit = cached.has_value();
+					stats.cacheLoadNs = loading.elapsedNs();
+				});
+				return cached;
+			}();
+			return ans;
+		}
+		
+		/// Recreate the two-level map of upcast symbols from the symbols stored in a cache file.
+		static std::map<std::string, std::map<std::string, std::string> > genCachedCasts(const detail::CachedCastsTable& cached) {
+			std::map<std::string, std::map<std::string, std::string> > knownCasts;
+			const std::vector<detail::UpcastDescriptor>& upcasts = hierarchyDescription().upcasts;
+			for(std::size_t i = 0; i < upcasts.size(); ++i) {
+				if(cached.symbols[i].length()) {
+					knownCasts[upcasts[i].derivedName()][upcasts[i].baseName()] = cached.symbols[i];
+				}
+			}
+			return knownCasts;
+		}
+		
+		/****************************************************************
+		 * Create a two-level map from derived classes to base classes to
+		 * the (mangled) symbols of the upcasts between them, keyed by
+		 * demangled names. In other words, `knownCasts["B"]["A"]` would
+		 * be the symbol for `CxxFFI::upcast<B,A>`.
+		 ****************************************************************/
+		static std::map<std::string, std::map<std::string, std::string> > genKnownCasts() {
+			std::map<std::string, std::map<std::string, std::string> > knownCasts;
+			if(const std::optional<detail::CachedCastsTable>& cached = cachedTable()) {
+				knownCasts = genCachedCasts(*cached);
+			} else if constexpr (discovery == CastDiscovery::Registered) {
+				knownCasts = genRegisteredCasts();
+			} else {
+				knownCasts = genScannedCasts();
+			}
+			std::uint64_t found = 0, missing = 0, shared = 0;
+			for(const detail::UpcastDescriptor& upcast : hierarchyDescription().upcasts) {
+				shared += upcast.shared;
+				auto derivedCasts = knownCasts.find(upcast.derivedName());
+				if(derivedCasts != knownCasts.end() && derivedCasts->second.count(upcast.baseName())) {
+					++found;
+				} else {
+					++missing;
+				}
+			}
+			stats().update([&](CastsTableStats& stats) {
+				stats.castsFound = found;
+				stats.castsMissing = missing;
+				stats.castsShared = shared;
+			});
+			return knownCasts;
+		}
+		
+		/****************************************************************
+		 * Index every upcast in the library by scanning its symbol table.
+		 * This is shared with the other tables in the library through
+		 * `Registry::imageUpcasts`, so it doesn't depend on the types
+		 * of this table.
+		 ****************************************************************/
+		static detail::ImageUpcasts genImageUpcasts() {
+			detail::UpcastSymbolMatcher matcher;
+			matcher.addAllTypes();
 			
 			// Traverse the symbol table for library in question and filter out the upcasts.
-			// These are guaranteed to have been instantiated by the fused runtime/compile-time
-			// loop present in `CastsTableSubEntries::operator()`. The (unused) `instantiateMe`
-			// field forces the instantiation of every type exposed in the API so that it will
-			// exist when execute this loop. wibbly-wobbly/timey-wimey
-			std::map<std::string, std::map<std::string, std::string> > knownCasts;
-			boost::dll::library_info inf(libraryLocation());
-			std::vector<std::string> exports(detail::symbolTable(inf));
-			std::string returnType, derivedType, baseType, argType;
-			for(std::string symbol : exports) {
-				std::string readable(boost::core::demangle(symbol.c_str()));
-				if(re2::RE2::FullMatch(readable, matchUpcast, &returnType, &derivedType, &baseType, &argType)) {
-					if(returnType == baseType && argType == derivedType) {
+			// These are guaranteed to have been instantiated by `detail::describeUpcast`, which
+			// takes the address of every upcast in the API of every table in the library.
+			detail::ImageUpcasts ans;
+			std::vector<std::string> exports;
+			detail::Stopwatch loading;
+			// `libraryLocation` lives in the library we're describing, which is already mapped, so prefer reading its symbols in place.
+			if(!detail::loadedImageSymbols(reinterpret_cast<const void*>(libraryLocation), exports)) {
 #ifdef DEBUG
-						std::cout << "knownCasts[" << argType << "][" << returnType << "] = " << symbol << std::endl;
+				std::cerr << "Couldn't read symbols in memory, falling back to reading " << libraryLocation() << std::endl;
 #endif
-						knownCasts[argType][returnType] = symbol;
-					}
-#ifdef DEBUG
-					else {
-						std::cerr << symbol << " parses as an upcast, but the types don't match: " << readable << std::endl;
+				exports.clear();
+				boost::dll::library_info inf(libraryLocation());
+				exports = detail::symbolTable(inf);
+			}
+			ans.symbolLoadNs = loading.elapsedNs();
+			
+			detail::Stopwatch matching;
+			detail::ScanCounters counters;
+			std::vector<detail::UpcastSymbolMatch> matches = detail::scanUpcastSymbols(matcher, exports, CXXFFI_SCAN_THREADS, 1 << 14, &counters);
+			ans.matchNs = matching.elapsedNs();
+			
+			for(const detail::UpcastSymbolMatch& match : matches) {
+				ans.casts[match.derived][match.base] = *match.symbol;
+			}
+			ans.demangleNs = counters.demangleNs;
+			ans.symbolsScanned = exports.size();
+			ans.symbolsDemangled = counters.demangled;
+			ans.symbolsMatched = matches.size();
+			return ans;
+		}
+		
+		/// Memoize the index of the upcasts in this table's library, which is shared with the other tables there via `Registry::imageUpcasts`.
+		static const detail::ImageUpcasts& imageUpcasts() {
+			static const detail::ImageUpcasts& ans = []() -> const detail::ImageUpcasts& {
+				bool shared = false;
+				const detail::ImageUpcasts& image = Registry::instance().imageUpcasts(detail::imageBase(imageAddress()), &CastsTable::genImageUpcasts, shared);
+				stats().update([&](CastsTableStats& stats) {
+					if(!shared) {
+						stats.symbolLoadNs = image.symbolLoadNs;
+						stats.matchNs = image.matchNs;
+						stats.demangleNs = image.demangleNs;
+						stats.symbolsScanned = image.symbolsScanned;
+						stats.symbolsDemangled = image.symbolsDemangled;
+						stats.symbolsMatched = image.symbolsMatched;
 					}
-#endif
+					stats.sharedScan = shared;
+				});
+				return image;
+			}();
+			return ans;
+		}
+		
+		/// Look up the symbol of `upcast` in `CastsTable::imageUpcasts`, returning `nullptr` if it wasn't found. Not for shared upcasts, which the scan doesn't find.
+		static const std::string* scannedSymbol(const detail::UpcastDescriptor& upcast) {
+			const detail::ImageUpcasts& image = imageUpcasts();
+			auto derivedCasts = image.casts.find(upcast.derivedName());
+			if(derivedCasts != image.casts.end()) {
+				auto baseCast = derivedCasts->second.find(upcast.baseName());
+				if(baseCast != derivedCasts->second.end()) {
+					return &baseCast->second;
 				}
+			}
+			return nullptr;
+		}
+		
+		/// Create a two-level map from derived classes to base classes to upcast symbols by filtering the index of the library's upcasts for this table's upcasts.
+		static std::map<std::string, std::map<std::string, std::string> > genScannedCasts() {
+			const detail::HierarchyDescription& description = hierarchyDescription();
+			imageUpcasts();
+			
+			detail::Stopwatch building;
+			std::map<std::string, std::map<std::string, std::string> > knownCasts;
+			for(const detail::UpcastDescriptor& upcast : description.upcasts) {
+				// Shared upcasts aren't instances of `CxxFFI::upcast`, but their addresses are known.
+				if(upcast.shared) {
+					if(const char *symbol = detail::resolveSymbolName(upcast.fn)) {
+						knownCasts[upcast.derivedName()][upcast.baseName()] = symbol;
+					}
+				} else if(const std::string *symbol = scannedSymbol(upcast)) {
 #ifdef DEBUG
-				else {
-					std::cout << "Skipping unmatched symbol " << symbol << " (aka " << readable << " )" << std::endl;
-				}
+					std::cout << "knownCasts[" << upcast.derivedName() << "][" << upcast.baseName() << "] = " << *symbol << std::endl;
 #endif
+					knownCasts[upcast.derivedName()][upcast.baseName()] = *symbol;
+				}
 			}
+			stats().update([&](CastsTableStats& stats) {
+				stats.mapBuildNs = building.elapsedNs();
+			});
 			
 			return knownCasts;
 		}
@@ -536,15 +1129,46 @@ namespace CxxFFI {
 			return ans;
 		}
 		
-		/// Build up the JSON blob for the casts table via invoking `CastsTableEntries` on each entry of `CastsTable::HierarchyFiltered`.
+		/// Look up the symbol of `upcast` in `CastsTable::knownCasts`, without inserting it. Returns an empty string if it wasn't found.
+		static const std::string& upcastSymbol(const detail::UpcastDescriptor& upcast) {
+			static const std::string noSymbol;
+			std::map<std::string, std::map<std::string, std::string> >& casts = knownCasts();
+			auto derivedCasts = casts.find(upcast.derivedName());
+			if(derivedCasts != casts.end()) {
+				auto baseCast = derivedCasts->second.find(upcast.baseName());
+				if(baseCast != derivedCasts->second.end()) {
+					return baseCast->second;
+				}
+			}
+			return noSymbol;
+		}
+		
+		/// Build up the JSON blob for the casts table via `detail::emitCastsTable`, in a single allocation.
 		static std::string genCastsTable() {
-			std::ostringstream o;
-			using Begin = typename boost::mpl::begin<HierarchyFiltered>::type;
-			using End = typename boost::mpl::end<HierarchyFiltered>::type;
-			using CastsTableEntries = detail::CastsTableEntries<Begin, End>;
-			CastsTableEntries entries{knownCasts()};
-			o << "{" << entries << "}";
-			return o.str();
+			std::string ans;
+			if(const std::optional<detail::CachedCastsTable>& cached = cachedTable()) {
+				ans = cached->json;
+			} else {
+				knownCasts();
+				detail::Stopwatch emitting;
+				ans = detail::writeJson([](auto& sink) {
+					detail::emitCastsTable(sink, hierarchyDescription(), &CastsTable::upcastSymbol);
+				});
+				stats().update([&](CastsTableStats& stats) {
+					stats.jsonEmitNs = emitting.elapsedNs();
+				});
+				if(cache().enabled()) {
+					detail::CachedCastsTable fresh{ans, {}};
+					for(const detail::UpcastDescriptor& upcast : hierarchyDescription().upcasts) {
+						fresh.symbols.push_back(upcastSymbol(upcast));
+					}
+					cache().store(fresh);
+				}
+			}
+			stats().update([&](CastsTableStats& stats) {
+				stats.jsonBytes = ans.size();
+			});
+			return ans;
 		}
 		
 		/// Memoize result of `CastsTable::genCastsTable()`
@@ -554,16 +1178,256 @@ namespace CxxFFI {
 			
 		};
 		
+		/// Encode `CastsTable::hierarchyDescription` and `CastsTable::knownCasts` in the layout described by `BinaryTableHeader`.
+		static std::vector<unsigned char> genBinaryTable() {
+			const detail::HierarchyDescription& description = hierarchyDescription();
+			knownCasts();
+			detail::Stopwatch emitting;
+			const detail::TypeIntervals& intervals = typeIntervals();
+			std::map<std::type_index, std::uint32_t> ids;
+			detail::BinaryTableBuilder builder;
+			for(const detail::TypeDescriptor& type : description.types) {
+				detail::PendingSymbol destroy = {type.destroyFn ? detail::resolveSymbol(type.destroyFn) : std::string(), type.destroyFn};
+				detail::TypeIntervals::Interval interval = intervals.interval(ids.size());
+				ids.emplace(*type.type, builder.addType(type.apiName(), type.size, type.align, interval.pre, interval.post, destroy));
+			}
+			for(const detail::UpcastDescriptor& upcast : description.upcasts) {
+				const std::string& symbol = upcastSymbol(upcast);
+				detail::PendingSymbol inPlace = {upcast.inPlaceFn ? detail::resolveSymbol(upcast.inPlaceFn) : std::string(), upcast.inPlaceFn};
+				detail::PendingSymbol batch = {detail::resolveSymbol(upcast.batchFn), upcast.batchFn};
+				detail::PendingSymbol down = {upcast.downFn ? detail::resolveSymbol(upcast.downFn) : std::string(), upcast.downFn};
+				std::uint32_t flags = (upcast.constantOffset ? CastHasConstantOffset : 0) | (upcast.intervalDowncast ? CastDowncastByInterval : 0) | (upcast.retypesInPlace ? CastRetypesInPlace : 0);
+				builder.addCast(ids.at(*upcast.derived), ids.at(*upcast.base), flags, upcast.offset, {symbol, upcast.fn}, inPlace, batch, down);
+			}
+			std::vector<unsigned char> ans = builder.finish();
+			stats().update([&](CastsTableStats& stats) {
+				stats.binaryEmitNs = emitting.elapsedNs();
+				stats.binaryBytes = ans.size();
+			});
+			return ans;
+		}
+		
+		/// Memoize result of `CastsTable::genBinaryTable()`
+		static const std::vector<unsigned char>& binaryTable() {
+			static const std::vector<unsigned char> ans = genBinaryTable();
+			return ans;
+		}
+		
+		/// Index `CastsTable::hierarchyDescription` for `CastsTable::typeId` and `CastsTable::findUpcast`, assigning the same type ids as `CastsTable::genBinaryTable`.
+		static detail::CastLookup genCastLookup() {
+			const detail::HierarchyDescription& description = hierarchyDescription();
+			std::map<std::type_index, std::uint32_t> ids;
+			detail::CastLookup lookup;
+			for(const detail::TypeDescriptor& type : description.types) {
+				ids.emplace(*type.type, lookup.addType(type.apiName()));
+			}
+			for(const detail::UpcastDescriptor& upcast : description.upcasts) {
+				lookup.addCast(ids.at(*upcast.derived), ids.at(*upcast.base), upcast.fn);
+				lookup.addDowncast(ids.at(*upcast.base), ids.at(*upcast.derived), upcast.downFn);
+			}
+			return lookup;
+		}
+		
+		/// Memoize result of `CastsTable::genCastLookup()`
+		static const detail::CastLookup& castLookup() {
+			static const detail::CastLookup ans = genCastLookup();
+			return ans;
+		}
+		
+		/// Number the single-inheritance chains in `CastsTable::hierarchyDescription`, assigning the same type ids as `CastsTable::genBinaryTable`.
+		static detail::TypeIntervals genTypeIntervals() {
+			const detail::HierarchyDescription& description = hierarchyDescription();
+			std::map<std::type_index, std::uint32_t> ids;
+			detail::TypeIntervals intervals;
+			for(const detail::TypeDescriptor& type : description.types) {
+				ids.emplace(*type.type, intervals.addType(*type.element, type.handle, type.singleChain));
+			}
+			// Each type's upcasts follow its toposorted bases, so the nearest ancestor comes first.
+			for(const detail::UpcastDescriptor& upcast : description.upcasts) {
+				intervals.addBase(ids.at(*upcast.derived), ids.at(*upcast.base));
+			}
+			intervals.finish();
+			return intervals;
+		}
+		
+		/// Memoize the `detail::TypePositions` of `CastsTable::hierarchyDescription`.
+		static const detail::TypePositions& typePositions() {
+			static const detail::TypePositions ans(hierarchyDescription());
+			return ans;
+		}
+		
+		/****************************************************************
+		 * Find the symbol of `hierarchyDescription().upcasts[index]`
+		 * without generating `CastsTable::knownCasts`, from the same
+		 * source: the cache, `dladdr`, or the index of the library's
+		 * upcasts. Returns `nullptr` if it wasn't found. The symbol is
+		 * NUL-terminated, and remains valid while the library is loaded.
+		 ****************************************************************/
+		static const char* lazySymbol(std::size_t index) {
+			if(const std::optional<detail::CachedCastsTable>& cached = cachedTable()) {
+				const std::string& symbol = cached->symbols[index];
+				return symbol.length() ? symbol.c_str() : nullptr;
+			}
+			const detail::UpcastDescriptor& upcast = hierarchyDescription().upcasts[index];
+			if constexpr (discovery == CastDiscovery::Registered) {
+				return detail::resolveSymbolName(upcast.fn);
+			} else if(upcast.shared) {
+				return detail::resolveSymbolName(upcast.fn);
+			} else {
+				const std::string *symbol = scannedSymbol(upcast);
+				return symbol ? symbol->c_str() : nullptr;
+			}
+		}
+		
+		/// Memoize the JSON object of the upcasts from each type, as it appears in `CastsTable::castsTable`, generating each only when first requested.
+		static const std::string& typeCastsTable(std::size_t type) {
+			static detail::LazyStrings ans(hierarchyDescription().types.size());
+			return ans.get(type, [type]() {
+				const detail::HierarchyDescription& description = hierarchyDescription();
+				const detail::UpcastDescriptor *first = description.upcasts.data() + typePositions().firstUpcasts[type];
+				return detail::writeJson([&](auto& sink) {
+					detail::emitUpcasts(sink, first, first + description.types[type].upcastCount, [&](const detail::UpcastDescriptor& upcast) {
+						const char *symbol = lazySymbol(&upcast - description.upcasts.data());
+						return std::string_view(symbol ? symbol : "");
+					});
+				});
+			});
+		}
+		
+		/// Call `visit` for each upcast from type `type` whose symbol is found, stopping at the first nonzero result, which is returned.
+		static int visitTypeCasts(std::size_t type, CastVisitor visit, void *context) {
+			const detail::HierarchyDescription& description = hierarchyDescription();
+			const detail::TypeDescriptor& derived = description.types[type];
+			std::size_t first = typePositions().firstUpcasts[type];
+			for(std::size_t i = first; i < first + derived.upcastCount; ++i) {
+				if(const char *symbol = lazySymbol(i)) {
+					if(int stop = visit(derived.apiName().c_str(), description.upcasts[i].baseApiName().c_str(), symbol, context)) {
+						return stop;
+					}
+				}
+			}
+			return 0;
+		}
+		
 	public:
+		/// Memoize result of `CastsTable::genTypeIntervals()`, for use by `CxxFFI::downcast`.
+		static const detail::TypeIntervals& typeIntervals() {
+			static const detail::TypeIntervals ans = genTypeIntervals();
+			return ans;
+		}
+		
 		/// Obtain the casts table JSON blob as a plain C string.
 		static const char * apply() {
 			return castsTable().c_str();
 		}
 		
+		/// Obtain the binary casts table, beginning with a `BinaryTableHeader`.
+		static const void * binary() {
+			return binaryTable().data();
+		}
+		
+		/// Obtain the id of the type whose name in the casts table is `name`, or `noTypeId`.
+		static std::uint32_t typeId(const char *name) {
+			return castLookup().typeId(name);
+		}
+		
+		/// Obtain a type-erased pointer to `CxxFFI::upcast` between two type ids, or `nullptr` if there is no such upcast.
+		static void (*findUpcast(std::uint32_t derived, std::uint32_t base))() {
+			return castLookup().findUpcast(derived, base);
+		}
+		
+		/// Obtain a type-erased pointer to `CxxFFI::downcast` between two type ids, or `nullptr` if there is no such downcast.
+		static void (*findDowncast(std::uint32_t base, std::uint32_t derived))() {
+			return castLookup().findDowncast(base, derived);
+		}
+		
+		/// Obtain the subtype matrix, beginning with a `SubtypeMatrixHeader`. It is a constant, so this never allocates or generates anything.
+		static const void * subtypes() {
+			return &SubtypeMatrix::buffer;
+		}
+		
+		/// Whether type id `derived` is a subtype of (or the same as) type id `base`, in O(1).
+		static bool isSubtype(std::uint32_t derived, std::uint32_t base) {
+			return SubtypeMatrix::isSubtype(derived, base);
+		}
+		
+		/// Obtain a snapshot of the statistics describing how this table has been generated so far.
+		static CastsTableStats statistics() {
+			return stats().snapshot();
+		}
+		
 		/// Obtain the known types regex as a plain C string.
 		static const char * knownTypes() {
 			return matchKnownTypes().c_str();
 		}
+		
+		/**************************************************
+		 * Obtain the JSON object mapping the names of the
+		 * bases of the type named `derived` to the symbols of
+		 * the upcasts to them, as it appears in the casts
+		 * table, or `nullptr` for unknown types. Only the
+		 * requested type's object is generated (and kept).
+		 **************************************************/
+		static const char * typeCasts(const char *derived) {
+			const std::unordered_map<std::string_view, std::size_t>& types = typePositions().types;
+			auto type = types.find(derived);
+			return type == types.end() ? nullptr : typeCastsTable(type->second).c_str();
+		}
+		
+		/**************************************************
+		 * Stream the entries of the casts table to `visit`,
+		 * in the same order, without generating the JSON: for
+		 * every upcast whose symbol is found, from the type
+		 * named `derived` (or from every type, if `derived` is
+		 * `nullptr`). Stops at the first nonzero result of
+		 * `visit`, and returns it, or else returns 0. Unknown
+		 * types have no entries.
+		 **************************************************/
+		static int forEachCast(const char *derived, CastVisitor visit, void *context) {
+			if(derived) {
+				const std::unordered_map<std::string_view, std::size_t>& types = typePositions().types;
+				auto type = types.find(derived);
+				return type == types.end() ? 0 : visitTypeCasts(type->second, visit, context);
+			}
+			for(std::size_t type = 0; type < hierarchyDescription().types.size(); ++type) {
+				if(int stop = visitTypeCasts(type, visit, context)) {
+					return stop;
+				}
+			}
+			return 0;
+		}
+		
+		/// Generate everything which the functions generated by #CXXFFI_EXPOSE memoize, so that later calls to them don't block. See #CXXFFI_EXPOSE_BACKGROUND.
+		static void warm() {
+			castsTable();
+			binaryTable();
+			castLookup();
+			typeIntervals();
+			typePositions();
+			matchKnownTypes();
+		}
+		
+		/// Describe this table's types, and the upcasts from them whose symbols were found, for `Registry` to merge.
+		static std::vector<detail::RegistryType> registryTypes() {
+			const detail::HierarchyDescription& description = hierarchyDescription();
+			std::vector<detail::RegistryType> ans;
+			const detail::UpcastDescriptor *upcast = description.upcasts.data();
+			for(const detail::TypeDescriptor& type : description.types) {
+				detail::RegistryType& entry = ans.emplace_back(detail::RegistryType{type.apiName(), {}});
+				for(const detail::UpcastDescriptor *end = upcast + type.upcastCount; upcast != end; ++upcast) {
+					const std::string& symbol = upcastSymbol(*upcast);
+					if(symbol.length()) {
+						entry.upcasts.emplace_back(upcast->baseApiName(), symbol);
+					}
+				}
+			}
+			return ans;
+		}
+		
+		/// Describe this table to `Registry`, as exposed under `name`.
+		static Registry::Table registryTable(const char *name) {
+			return {name, detail::imageBase(imageAddress()), &CastsTable::registryTypes};
+		}
 	};
 	
 	namespace detail {
@@ -587,21 +1451,36 @@ namespace CxxFFI {
 		};
 	}
 	
-	template<typename T> struct APIFilter; // Forward declaration to allow use in following MPL meta-func
+	template<typename T> struct APIFilter; // Forward declaration to allow use in following meta-funcs
 	
 	namespace detail {
-		/// Convert `APIFilter` to the `boost::mpi` convention of metafunctions requiring a wrapper struct.
-		struct APIFilterApplier {
-			template<typename T> struct apply {
-				using type = typename APIFilter<T>::type;
-			};
+		/// Convert `APIFilter` to a predicate with a boolean `value`.
+		template<typename T> struct PassesAPIFilter : std::bool_constant<APIFilter<T>::type::value> {};
+		
+		/// Metafunction testing whether any element of the `TypeList` `Bases` passes `APIFilter`.
+		template<typename Bases> struct AnyPassesAPIFilter;
+		
+		/// Implementation of `AnyPassesAPIFilter`.
+		template<typename ...Bases> struct AnyPassesAPIFilter<TypeList<Bases...>> {
+			using type = boost::mpl::bool_<(APIFilter<Bases>::type::value || ...)>; ///< The disjunction of `APIFilter` over `Bases...`.
+		};
+		
+		/// Default implementation of `APIFilter`, accepting `T` if any of its reflected bases pass.
+		template<typename T, bool handle = CovariantHandle<T>::value> struct DefaultAPIFilter {
+			using type = typename AnyPassesAPIFilter<AsTypeList<typename CxxFFI::ReflBases<T>::type>>::type;
+		};
+		
+		/// Specialization of `DefaultAPIFilter` for `CovariantHandle`s, accepting them if their element type passes.
+		template<typename T> struct DefaultAPIFilter<T, true> {
+			using type = typename APIFilter<typename CovariantHandle<T>::element_type>::type;
 		};
 	};
 	
 	/******************************************************************
 	 * A metafunction to filter types which should not appear in the 
 	 * generated casts table. The default implementation accepts
-	 * a class if any of its base classes are accepted.
+	 * a class if any of its base classes are accepted, and a
+	 * `CovariantHandle` if its element type is accepted.
 	 * 
 	 * Client code can define customizations via specialization.
 	 * @tparam T The type to accepted or rejected for inclusion in the casts table.
@@ -611,12 +1490,8 @@ namespace CxxFFI {
 	 * specializations for at least the set of base-classes.
 	 ******************************************************************/
 	template<typename T> struct APIFilter {
-	private:
-		using Bases = typename CxxFFI::ReflBases<T>::type; ///< Access `T`'s reflected base types.
-		using BasesPass = typename boost::mpl::transform<Bases,detail::APIFilterApplier>::type; ///< Recursively apply `APIFilter` to each type in `Bases`.
-	public:
-		/// boost::mpl:bool_<false> if rejected or boost::mpl::bool_<true> if accepted.
-		using type = typename boost::mpl::fold<BasesPass, boost::mpl::bool_<false>, boost::mpl::or_<boost::mpl::_1, boost::mpl::_2>>::type;
+		/// boost::mpl:bool_<false> if rejected or boost::mpl::bool_<true> if accepted, by recursively applying `APIFilter` to each of `T`'s reflected bases, via `detail::DefaultAPIFilter`.
+		using type = typename detail::DefaultAPIFilter<T>::type;
 	};
 	
 	/// Specialization of `APIFilter` passing `std::shared_ptr<T>` if `T` passes.
@@ -632,15 +1507,14 @@ namespace CxxFFI {
 		};
 		
 		/******************************************************************
-		 * A metafunction to extract (as a `boost::mpl::vector`) the types 
+		 * A metafunction to extract (as a `TypeList`) the types 
 		 * appearing in a function signature, stripped of cv-qualification, 
 		 * references, pointers, and array-extents.
 		 ******************************************************************/
 		template<typename R, typename ...Args> class apply<R(Args...)> {
-			using RawTypes = boost::mpl::vector<R, Args...>; ///< The types appearing in the signature
 		public:
-			/// The result vector
-			using type = typename boost::mpl::transform<RawTypes, detail::BareType>::type;
+			/// The result list
+			using type = TypeList<typename detail::BareType::apply<R>::type, typename detail::BareType::apply<Args>::type...>;
 		};
 	};
 	
@@ -650,34 +1524,20 @@ namespace CxxFFI {
 		 * A metafunction to extract all of the unique types (up to 
 		 * equivalence under `detail::BareType`) appearing in the signatures
 		 * of some set of function types.
-		 * @tparam Funcs The `boost::mpl::vector` of function types to examine
+		 * @tparam Funcs The `TypeList` (or `boost::mpl` sequence) of function types to examine
 		 ******************************************************************/
 		template<typename Funcs> class apply {
-			using FuncTypes = typename boost::mpl::transform<Funcs, ExtractFuncTypes>::type; ///< Extract the bare types from each function type, result is a vector of vectors
-			using UniqueFuncTypes = typename boost::mpl::transform<FuncTypes, detail::Vec2Set>::type; ///< Convert the inner vectors to sets
-			using SeedTypes = typename boost::mpl::fold<UniqueFuncTypes, boost::mpl::set0<>, detail::SetUnion>::type; ///< Union the inner sets into a single set
+			using FuncTypes = Transform<ExtractFuncTypes::apply, AsTypeList<Funcs>>; ///< Extract the bare types from each function type, result is a list of lists
+			using UniqueFuncTypes = Transform<detail::Vec2Set::apply, FuncTypes>; ///< Convert the inner lists to sets
+			using SeedTypes = UnionAll<UniqueFuncTypes>; ///< Union the inner sets into a single set
 		public:
-			/// Return the elements of `SeedTypes` which pass the `APIFilter`.
-			using type = typename boost::mpl::copy_if<SeedTypes, detail::APIFilterApplier, boost::mpl::inserter<boost::mpl::set0<>, boost::mpl::insert<boost::mpl::_1, boost::mpl::_2>>>::type;
+			/// Return the elements of `SeedTypes` which pass the `APIFilter`, as a set.
+			using type = ToSet<Filter<detail::PassesAPIFilter, SeedTypes>>;
 		};
 	};
 	
-	namespace detail {
-		using namespace boost::mpl;
-		/// Metafunction constructing an empty `boost::mpl::vector` (recursive base case)
-		template<typename ...Args> struct VariadicVectorConstructor {
-			using type = vector0<>;
-		};
-		
-		/// Recursive metafunction to construct the `boost::mpl::vector` consisting of `Head` followed by `Tail...`.
-		template<typename Head, typename ...Tail> struct VariadicVectorConstructor<Head, Tail...> {
-			/// Construct the `Tail...` and then prepend `Head`.
-			using type = typename push_front<typename VariadicVectorConstructor<Tail...>::type, Head>::type;
-		};
-	}
-	
-	/// For some goofy reason, `boost::mpl::vector`s have to be constructed by adding elements one at a time, so here is a convenience wrapper as a variadic template.
-	template<typename ...Args> using Vector = typename detail::VariadicVectorConstructor<Args...>::type;
+	/// Retained for compatibility with code predating `TypeList`, which can be constructed directly.
+	template<typename ...Args> using Vector = TypeList<Args...>;
 }
 
 /**************************************************************
@@ -715,13 +1575,224 @@ namespace CxxFFI {
  * boost preprocessor sequence](https://www.boost.org/doc/libs/1_73_0/libs/preprocessor/doc/data/sequences.html)
  * enumerating the API functions from whose signatures the set of relevant
  * API classes should be extracted.
+ * 
+ * Also generates `const void* NAME_binary()`, returning the same
+ * casts table in the binary layout described by 
+ * `CxxFFI::BinaryTableHeader`, which can be read in place.
+ * 
+ * Also generates `uint32_t NAME_type_id(const char*)` and
+ * `void (*NAME_find_upcast(uint32_t, uint32_t))(void)`, which look
+ * up type ids (as in the binary table) by name, and upcasts by
+ * pair of type ids, in constant time. See #CXXFFI_EXPOSE_LOOKUP.
+ * 
+ * Also generates `void (*NAME_find_downcast(uint32_t, uint32_t))(void)`,
+ * which looks up the checked `CxxFFI::downcast` from a base to a 
+ * derived type id, for polymorphic bases. Downcasts return `NULL`
+ * if the object isn't of the derived type. They are listed in the
+ * binary table, but not the JSON, whose format is unchanged.
+ * 
+ * Also generates `int NAME_is_subtype(uint32_t, uint32_t)`, which
+ * tests whether one type id is a subtype of (or the same as)
+ * another, and `const void* NAME_subtypes()`, returning the
+ * underlying bitset matrix in the layout described by 
+ * `CxxFFI::SubtypeMatrixHeader`. Both are computed at compile time.
+ * 
+ * Also generates `CxxFFI::CastsTableStats NAME_stats()`, returning
+ * timings and counters for the phases of generation which have run
+ * so far, for monitoring startup cost.
+ * 
+ * For callers which only need a few types, also generates
+ * `const char* NAME_type_casts(const char *derived)`, returning the
+ * JSON object which `NAME()` maps `derived` to (or `NULL` if it isn't
+ * in the table), and `int NAME_for_each_cast(const char *derived,
+ * CxxFFI::CastVisitor visit, void *context)`, which streams the
+ * entries from `derived` (or every type, if it is `NULL`) to `visit`,
+ * stopping at and returning its first nonzero result. Neither
+ * generates the whole table, and in registered mode, only the
+ * requested types' symbols are resolved.
+ * 
+ * The table joins the process-wide `CxxFFI::Registry` when the
+ * library is loaded, so that every table in the library shares one
+ * scan of its symbols. See #CXXFFI_EXPOSE_REGISTRY.
  **************************************************************/
-#define CXXFFI_EXPOSE(NAME, LOC, XS) \
+#define CXXFFI_EXPOSE(NAME, LOC, XS) _CXXFFI_EXPOSE_IMPL(NAME, LOC, XS, CxxFFI::CastDiscovery::SymbolScan)
+
+/**************************************************************
+ * @def CXXFFI_EXPOSE_REGISTERED(NAME, XS)
+ * As #CXXFFI_EXPOSE, but records the address of each `CxxFFI::upcast`
+ * instantiation in a static table, and resolves their symbol names
+ * via `dladdr`, rather than demangling and matching every symbol
+ * in the library. This avoids reading the library from disk, and
+ * continues to work when the library has been stripped (so long
+ * as the upcasts remain in the dynamic symbol table, as they
+ * must for `dlsym` to find them).
+ * 
+ * @param NAME The name of the generated function returning
+ * the JSON description of the class hierarchy.
+ * @param XS As for #CXXFFI_EXPOSE.
+ **************************************************************/
+#define CXXFFI_EXPOSE_REGISTERED(NAME, XS) _CXXFFI_EXPOSE_IMPL(NAME, nullptr, XS, CxxFFI::CastDiscovery::Registered)
+
+/**************************************************************
+ * @def CXXFFI_EXPOSE_BACKGROUND(NAME, LOC, XS)
+ * As #CXXFFI_EXPOSE, but starts generating everything the
+ * generated functions memoize on a background thread as soon as
+ * the library is loaded, so that the cost overlaps with the rest
+ * of startup instead of falling on the first caller.
+ * 
+ * Also generates `int NAME_ready()`, which returns 1 without
+ * blocking once the background work has finished (after which
+ * none of the generated functions block), and 0 before, and
+ * `const char* NAME_wait()`, which blocks until the work is done
+ * (sharing it with the background thread, rather than repeating
+ * it), and returns `NAME()`.
+ * 
+ * The background thread may start before the rest of the
+ * library's static initializers have run, so customizations
+ * such as `CxxFFI::NameRewriter` mustn't depend on namespace-scope
+ * statics. Unloading the library (or exiting) waits for it to
+ * finish. Don't `fork` until `NAME_ready()`.
+ **************************************************************/
+#define CXXFFI_EXPOSE_BACKGROUND(NAME, LOC, XS) \
+_CXXFFI_EXPOSE_IMPL(NAME, LOC, XS, CxxFFI::CastDiscovery::SymbolScan)\
+_CXXFFI_BACKGROUND_IMPL(NAME)
+
+/**************************************************************
+ * @def CXXFFI_EXPOSE_REGISTERED_BACKGROUND(NAME, XS)
+ * As #CXXFFI_EXPOSE_REGISTERED, with the background initialization
+ * of #CXXFFI_EXPOSE_BACKGROUND.
+ **************************************************************/
+#define CXXFFI_EXPOSE_REGISTERED_BACKGROUND(NAME, XS) \
+_CXXFFI_EXPOSE_IMPL(NAME, nullptr, XS, CxxFFI::CastDiscovery::Registered)\
+_CXXFFI_BACKGROUND_IMPL(NAME)
+
+/**************************************************************
+ * @def _CXXFFI_BACKGROUND_IMPL(NAME)
+ * Shared implementation of #CXXFFI_EXPOSE_BACKGROUND and
+ * #CXXFFI_EXPOSE_REGISTERED_BACKGROUND, following the expansion
+ * of #_CXXFFI_EXPOSE_IMPL for `NAME`.
+ **************************************************************/
+#define _CXXFFI_BACKGROUND_IMPL(NAME) \
+static CxxFFI::detail::BackgroundInit BOOST_PP_CAT(cxxffiBackground_, NAME)(&BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::warm);\
+extern "C" { \
+	int BOOST_PP_CAT(NAME, _ready)(){\
+		return BOOST_PP_CAT(cxxffiBackground_, NAME).ready();\
+	}\
+	const char* BOOST_PP_CAT(NAME, _wait)(){\
+		BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::warm();\
+		return NAME();\
+	}\
+}
+
+/**************************************************************
+ * @def _CXXFFI_EXPOSE_IMPL(NAME, LOC, XS, DISCOVERY)
+ * Shared implementation of #CXXFFI_EXPOSE and #CXXFFI_EXPOSE_REGISTERED.
+ * @param DISCOVERY The `CxxFFI::CastDiscovery` strategy to use.
+ **************************************************************/
+#define _CXXFFI_EXPOSE_IMPL(NAME, LOC, XS, DISCOVERY) \
+struct BOOST_PP_CAT(CxxFFIExposed_, NAME) {\
+	using APIFuncs = CxxFFI::Vector< BOOST_PP_SEQ_ENUM(BOOST_PP_SEQ_FOR_EACH(_CXXFFI_DECLTYPE_PASTER, _, XS)) >;\
+	using APITypes = typename CxxFFI::DiscoverAPITypes::apply<APIFuncs>::type;\
+	using CastsTable = CxxFFI::CastsTable<LOC, APITypes, DISCOVERY>;\
+};\
 extern "C" { \
 	const char* NAME(){\
-		using APIFuncs = CxxFFI::Vector< BOOST_PP_SEQ_ENUM(BOOST_PP_SEQ_FOR_EACH(_CXXFFI_DECLTYPE_PASTER, _, XS)) >;\
-		using APITypes = typename CxxFFI::DiscoverAPITypes::apply<APIFuncs>::type;\
-		using CastsTable = CxxFFI::CastsTable<LOC, APITypes>;\
-		return CastsTable::apply();\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::apply();\
+	}\
+	const void* BOOST_PP_CAT(NAME, _binary)(){\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::binary();\
+	}\
+	std::uint32_t BOOST_PP_CAT(NAME, _type_id)(const char *name){\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::typeId(name);\
+	}\
+	void (*BOOST_PP_CAT(NAME, _find_upcast)(std::uint32_t derived, std::uint32_t base))(){\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::findUpcast(derived, base);\
+	}\
+	void (*BOOST_PP_CAT(NAME, _find_downcast)(std::uint32_t base, std::uint32_t derived))(){\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::findDowncast(base, derived);\
+	}\
+	const void* BOOST_PP_CAT(NAME, _subtypes)(){\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::subtypes();\
+	}\
+	int BOOST_PP_CAT(NAME, _is_subtype)(std::uint32_t derived, std::uint32_t base){\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::isSubtype(derived, base);\
+	}\
+	CxxFFI::CastsTableStats BOOST_PP_CAT(NAME, _stats)(){\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::statistics();\
+	}\
+	const char* BOOST_PP_CAT(NAME, _type_casts)(const char *derived){\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::typeCasts(derived);\
+	}\
+	int BOOST_PP_CAT(NAME, _for_each_cast)(const char *derived, CxxFFI::CastVisitor visit, void *context){\
+		return BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::forEachCast(derived, visit, context);\
+	}\
+}\
+static const CxxFFI::detail::RegistryMembership BOOST_PP_CAT(cxxffiMembership_, NAME)(BOOST_PP_CAT(CxxFFIExposed_, NAME)::CastsTable::registryTable(BOOST_PP_STRINGIZE(NAME)));
+
+/**************************************************************
+ * @def CXXFFI_EXPOSE_LOOKUP(NAME)
+ * Generates the library-wide lookup functions
+ * `uint32_t cxxffi_type_id(const char*)`,
+ * `void (*cxxffi_find_upcast(uint32_t, uint32_t))(void)`,
+ * `void (*cxxffi_find_downcast(uint32_t, uint32_t))(void)`,
+ * `int cxxffi_is_subtype(uint32_t, uint32_t)`, and
+ * `const void* cxxffi_subtypes()`, forwarding to `NAME_type_id`,
+ * `NAME_find_upcast`, `NAME_find_downcast`, `NAME_is_subtype`,
+ * and `NAME_subtypes` for a casts table generated by 
+ * #CXXFFI_EXPOSE or #CXXFFI_EXPOSE_REGISTERED.
+ * Since these names are unprefixed, use at most once per library.
+ * `cxxffi_type_id` returns `UINT32_MAX` for unknown names, and
+ * `cxxffi_find_upcast` and `cxxffi_find_downcast` return `NULL`
+ * for unrelated or unknown types.
+ * 
+ * @param NAME As for the casts table to expose.
+ **************************************************************/
+#define CXXFFI_EXPOSE_LOOKUP(NAME) \
+extern "C" { \
+	std::uint32_t cxxffi_type_id(const char *name){\
+		return BOOST_PP_CAT(NAME, _type_id)(name);\
+	}\
+	void (*cxxffi_find_upcast(std::uint32_t derived, std::uint32_t base))(){\
+		return BOOST_PP_CAT(NAME, _find_upcast)(derived, base);\
+	}\
+	void (*cxxffi_find_downcast(std::uint32_t base, std::uint32_t derived))(){\
+		return BOOST_PP_CAT(NAME, _find_downcast)(base, derived);\
+	}\
+	int cxxffi_is_subtype(std::uint32_t derived, std::uint32_t base){\
+		return BOOST_PP_CAT(NAME, _is_subtype)(derived, base);\
+	}\
+	const void* cxxffi_subtypes(){\
+		return BOOST_PP_CAT(NAME, _subtypes)();\
+	}\
+}
+
+/**************************************************************
+ * @def CXXFFI_EXPOSE_REGISTRY()
+ * Generates `const char* cxxffi_registry_casts_table()`, returning
+ * a JSON casts table merging every table in the process which has
+ * joined the `CxxFFI::Registry`, and
+ * `const char* cxxffi_registry_library_casts_table(const void*)`,
+ * returning the same for only the tables in the library containing
+ * the given address (e.g. a symbol found with `dlsym`). Both are
+ * in the same format as the tables generated by #CXXFFI_EXPOSE,
+ * and remain valid for the lifetime of the process.
+ * 
+ * Also generates `CxxFFI::RegistryStats cxxffi_registry_stats()`,
+ * counting the joined tables, and the scans of their libraries'
+ * symbols.
+ * 
+ * Since these names are unprefixed, use at most once per library.
+ * Every library which does so serves the same registry.
+ **************************************************************/
+#define CXXFFI_EXPOSE_REGISTRY() \
+extern "C" { \
+	const char* cxxffi_registry_casts_table(){\
+		return CxxFFI::Registry::instance().castsTable().c_str();\
+	}\
+	const char* cxxffi_registry_library_casts_table(const void *addressInLibrary){\
+		return CxxFFI::Registry::instance().castsTable(CxxFFI::detail::imageBase(addressInLibrary)).c_str();\
+	}\
+	CxxFFI::RegistryStats cxxffi_registry_stats(){\
+		return CxxFFI::Registry::instance().statistics();\
 	}\
 }
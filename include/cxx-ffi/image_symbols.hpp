@@ -0,0 +1,233 @@
+#pragma once
+/************************************************************************************
+ * @file image_symbols.hpp
+ * Enumerate the dynamic symbols and read the build-id of an image already loaded into
+ * this process, by walking its program headers in memory rather than rereading the
+ * file from disk.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <dlfcn.h>
+#if defined(__ELF__)
+#include <link.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace CxxFFI {
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+#if defined(__ELF__)
+		/// The parts of a loaded image's dynamic section needed to enumerate its symbols.
+		struct LoadedImage {
+			const void *base = nullptr; ///< The image's load address, as reported by `dladdr`.
+			ElfW(Addr) bias = 0; ///< Difference between the image's virtual addresses and its addresses in memory.
+			const ElfW(Sym) *symbols = nullptr; ///< `DT_SYMTAB`.
+			const char *strings = nullptr; ///< `DT_STRTAB`.
+			const ElfW(Word) *sysvHash = nullptr; ///< `DT_HASH`, if present.
+			const std::uint32_t *gnuHash = nullptr; ///< `DT_GNU_HASH`, if present.
+			std::string buildId; ///< The raw bytes of the `NT_GNU_BUILD_ID` note, if present.
+		};
+
+		/// Search the `PT_NOTE` segment at `notes` for `NT_GNU_BUILD_ID`, and if found copy it to `buildId`.
+		inline void findBuildId(const unsigned char *notes, std::size_t size, std::size_t align, std::string &buildId) {
+			auto pad = [align](std::size_t n) { return (n + align - 1) & ~(align - 1); };
+			std::size_t offset = 0;
+			while(offset + sizeof(ElfW(Nhdr)) <= size) {
+				const ElfW(Nhdr) *note = reinterpret_cast<const ElfW(Nhdr)*>(notes + offset);
+				std::size_t name = offset + sizeof(ElfW(Nhdr));
+				std::size_t desc = name + pad(note->n_namesz);
+				if(desc + note->n_descsz > size) {
+					return;
+				}
+				if(note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 && std::memcmp(notes + name, "GNU", 4) == 0) {
+					buildId.assign(reinterpret_cast<const char*>(notes + desc), note->n_descsz);
+					return;
+				}
+				offset = desc + pad(note->n_descsz);
+			}
+		}
+
+		/****************************************************************
+		 * Convert a `d_ptr` from the dynamic section to an address.
+		 * glibc relocates these in place at load time, but other loaders
+		 * (e.g. musl) leave them as virtual addresses.
+		 ****************************************************************/
+		inline const void* dynamicAddress(ElfW(Addr) bias, ElfW(Addr) ptr) {
+			return reinterpret_cast<const void*>(ptr < bias ? ptr + bias : ptr);
+		}
+
+		/// `dl_iterate_phdr` callback which fills in the `LoadedImage` whose `LoadedImage::base` matches.
+		inline int matchLoadedImage(struct dl_phdr_info *info, std::size_t, void *data) {
+			LoadedImage &image = *static_cast<LoadedImage*>(data);
+			const ElfW(Dyn) *dynamic = nullptr;
+			bool contains = false;
+			for(ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+				const ElfW(Phdr) &phdr = info->dlpi_phdr[i];
+				ElfW(Addr) start = info->dlpi_addr + phdr.p_vaddr;
+				if(phdr.p_type == PT_LOAD && start <= ElfW(Addr)(image.base) && ElfW(Addr)(image.base) < start + phdr.p_memsz) {
+					contains = true;
+				} else if(phdr.p_type == PT_DYNAMIC) {
+					dynamic = reinterpret_cast<const ElfW(Dyn)*>(start);
+				}
+			}
+			if(!contains || !dynamic) {
+				return 0;
+			}
+			image.bias = info->dlpi_addr;
+			for(ElfW(Half) i = 0; i < info->dlpi_phnum && image.buildId.empty(); ++i) {
+				const ElfW(Phdr) &phdr = info->dlpi_phdr[i];
+				if(phdr.p_type == PT_NOTE) {
+					findBuildId(reinterpret_cast<const unsigned char*>(info->dlpi_addr + phdr.p_vaddr), phdr.p_memsz, phdr.p_align == 8 ? 8 : 4, image.buildId);
+				}
+			}
+			for(const ElfW(Dyn) *d = dynamic; d->d_tag != DT_NULL; ++d) {
+				switch(d->d_tag) {
+					case DT_SYMTAB:
+						image.symbols = static_cast<const ElfW(Sym)*>(dynamicAddress(image.bias, d->d_un.d_ptr));
+						break;
+					case DT_STRTAB:
+						image.strings = static_cast<const char*>(dynamicAddress(image.bias, d->d_un.d_ptr));
+						break;
+					case DT_HASH:
+						image.sysvHash = static_cast<const ElfW(Word)*>(dynamicAddress(image.bias, d->d_un.d_ptr));
+						break;
+					case DT_GNU_HASH:
+						image.gnuHash = static_cast<const std::uint32_t*>(dynamicAddress(image.bias, d->d_un.d_ptr));
+						break;
+				}
+			}
+			return 1;
+		}
+
+		/****************************************************************
+		 * The number of entries in the dynamic symbol table. The ELF
+		 * dynamic section doesn't record this directly, so it is
+		 * recovered from `DT_HASH` (whose chain count equals it), or else
+		 * from the last chain in `DT_GNU_HASH`.
+		 ****************************************************************/
+		inline std::size_t dynamicSymbolCount(const LoadedImage &image) {
+			if(image.sysvHash) {
+				return image.sysvHash[1];
+			} else if(image.gnuHash) {
+				std::uint32_t nbuckets = image.gnuHash[0], symoffset = image.gnuHash[1], bloomSize = image.gnuHash[2];
+				const std::uint32_t *buckets = image.gnuHash + 4 + bloomSize * (sizeof(ElfW(Addr)) / sizeof(std::uint32_t));
+				const std::uint32_t *chains = buckets + nbuckets;
+				std::uint32_t last = 0;
+				for(std::uint32_t i = 0; i < nbuckets; ++i) {
+					if(buckets[i] > last) {
+						last = buckets[i];
+					}
+				}
+				if(last < symoffset) {
+					return symoffset;
+				}
+				while(!(chains[last - symoffset] & 1)) {
+					++last;
+				}
+				return last + 1;
+			} else {
+				return 0;
+			}
+		}
+
+		/// Locate the loaded image containing `addressInImage`, returning `false` if it can't be found.
+		inline bool findLoadedImage(const void *addressInImage, LoadedImage &image) {
+			Dl_info info;
+			if(!dladdr(addressInImage, &info) || !info.dli_fbase) {
+				return false;
+			}
+			image.base = info.dli_fbase;
+			return dl_iterate_phdr(&matchLoadedImage, &image);
+		}
+#endif
+
+		/****************************************************************
+		 * Collect the names of the functions defined in the dynamic
+		 * symbol table of the loaded image containing `addressInImage`,
+		 * without any file I/O. Only the dynamic symbol table is mapped
+		 * at runtime, but upcasts must appear there for `dlsym` anyway.
+		 * @return `false` if the image couldn't be inspected in memory
+		 * (e.g. on non-ELF platforms), in which case the caller should
+		 * fall back to reading the library from disk.
+		 ****************************************************************/
+		inline bool loadedImageSymbols(const void *addressInImage, std::vector<std::string> &out) {
+#if defined(__ELF__)
+			LoadedImage image;
+			if(!findLoadedImage(addressInImage, image) || !image.symbols || !image.strings) {
+				return false;
+			}
+			std::size_t count = dynamicSymbolCount(image);
+			if(!count) {
+				return false;
+			}
+			for(std::size_t i = 0; i < count; ++i) {
+				const ElfW(Sym) &sym = image.symbols[i];
+				if(ELF64_ST_TYPE(sym.st_info) == STT_FUNC && sym.st_shndx != SHN_UNDEF) {
+					out.emplace_back(image.strings + sym.st_name);
+				}
+			}
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		/****************************************************************
+		 * The base address of the loaded image containing `addressInImage`,
+		 * which identifies the image for as long as it stays loaded, or
+		 * `addressInImage` itself if it isn't in any image known to `dladdr`.
+		 ****************************************************************/
+		inline const void* imageBase(const void *addressInImage) {
+			Dl_info info;
+			if(!dladdr(addressInImage, &info) || !info.dli_fbase) {
+				return addressInImage;
+			}
+			return info.dli_fbase;
+		}
+
+		/****************************************************************
+		 * Read the `NT_GNU_BUILD_ID` of the loaded image containing
+		 * `addressInImage` into `out`, as lowercase hex.
+		 * @return `false` if the image has no build-id, or couldn't be
+		 * inspected (e.g. on non-ELF platforms).
+		 ****************************************************************/
+		inline bool loadedImageBuildId(const void *addressInImage, std::string &out) {
+#if defined(__ELF__)
+			LoadedImage image;
+			if(!findLoadedImage(addressInImage, image) || image.buildId.empty()) {
+				return false;
+			}
+			static constexpr char digits[] = "0123456789abcdef";
+			out.clear();
+			for(unsigned char c : image.buildId) {
+				out.push_back(digits[c >> 4]);
+				out.push_back(digits[c & 0xf]);
+			}
+			return true;
+#else
+			return false;
+#endif
+		}
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+/************************************************************************************
+ * @file json_writer.hpp
+ * Two-pass emission of JSON into a single, exactly-sized buffer: the first pass
+ * measures, and the second escapes and copies in place, so emitting a large casts
+ * table makes one allocation rather than one (or more) per entry.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace CxxFFI {
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/// Whether `c` must be escaped within a quoted string. Matches `std::quoted`, which escapes only the delimiter and the escape character.
+		constexpr bool needsEscape(char c) {
+			return c == '"' || c == '\\';
+		}
+
+		/// A sink which counts the bytes `JsonWriter` would write for the same calls.
+		class JsonSizer {
+			std::size_t total = 0;
+		public:
+			/// Account for `s`, verbatim.
+			void raw(std::string_view s) {
+				total += s.size();
+			}
+
+			/// Account for `s`, quoted and escaped.
+			void quoted(std::string_view s) {
+				total += s.size() + 2;
+				for(char c : s) {
+					total += needsEscape(c);
+				}
+			}
+
+			/// The number of bytes accounted for so far.
+			std::size_t size() const {
+				return total;
+			}
+		};
+
+		/// A sink which writes into a buffer of at least the size measured by `JsonSizer`, without bounds checks or allocation.
+		class JsonWriter {
+			char *cursor;
+		public:
+			explicit JsonWriter(char *buffer) : cursor(buffer) {}
+
+			/// Write `s`, verbatim.
+			void raw(std::string_view s) {
+				std::memcpy(cursor, s.data(), s.size());
+				cursor += s.size();
+			}
+
+			/// Write `s` in double quotes, escaping exactly as `std::quoted` would.
+			void quoted(std::string_view s) {
+				*cursor++ = '"';
+				for(char c : s) {
+					if(needsEscape(c)) {
+						*cursor++ = '\\';
+					}
+					*cursor++ = c;
+				}
+				*cursor++ = '"';
+			}
+
+			/// One past the last byte written.
+			const char* end() const {
+				return cursor;
+			}
+		};
+
+		/**************************************************
+		 * Run `emit`, a function template of one sink
+		 * argument, once with a `JsonSizer` and once with a
+		 * `JsonWriter`, returning the result with exactly
+		 * one allocation. `emit` must make the same calls
+		 * both times.
+		 **************************************************/
+		template<typename Emit> std::string writeJson(Emit emit) {
+			JsonSizer sizer;
+			emit(sizer);
+			std::string ans(sizer.size(), '\0');
+			JsonWriter writer(&ans[0]);
+			emit(writer);
+			return ans;
+		}
+	}
+}
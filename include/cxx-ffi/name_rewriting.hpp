@@ -0,0 +1,204 @@
+#pragma once
+/************************************************************************************
+ * @file name_rewriting.hpp
+ * Structural rewriting of demangled type names: locating the arguments of a
+ * template-id (however deeply nested), replacing them, and flattening the inline
+ * ABI namespaces of the standard library, in linear time and without regexes.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CxxFFI {
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/// Whether `c` may appear in an identifier (or a numeric literal) in a demangled name.
+		constexpr bool isIdentifierChar(char c) {
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$';
+		}
+
+		/// Whether `identifier` names an inline namespace which the standard library uses to version its ABI: `std::__1` (libc++), `std::__ndk1` (Android's libc++), or `std::__cxx11` (libstdc++).
+		constexpr bool isStdABINamespace(std::string_view identifier) {
+			return identifier == "__1" || identifier == "__ndk1" || identifier == "__cxx11";
+		}
+
+		/******************************************************
+		 * Rewrites demangled type names into a buffer which is
+		 * reused from one call to the next. A name is scanned
+		 * once to find the top-level arguments of its template
+		 * argument list (the last one, for members of class
+		 * templates such as `Outer<X>::Inner<Y>`), and then
+		 * copied once, substituting replacements for those
+		 * arguments and optionally dropping inline ABI
+		 * namespaces wherever they follow a leading `std::`.
+		 * Nested template arguments are left to the rewriters
+		 * of the types they name, which is what makes the
+		 * rewriting of `NameRewriter` recursive.
+		 ******************************************************/
+		class TypeNameRewriter {
+		public:
+			/// The extent of one template argument within a name, excluding surrounding whitespace.
+			struct Argument {
+				std::size_t begin; ///< Offset of the first character.
+				std::size_t end; ///< Offset one past the last character.
+			};
+
+		private:
+			std::vector<Argument> arguments; ///< The arguments found by the last call to `TypeNameRewriter::scan`.
+			std::string buffer; ///< The result of the last call to `TypeNameRewriter::rewrite`.
+
+			/// Append `text` to `buffer`, dropping `__1::` (etc.) after any `std::` which doesn't itself follow `::`.
+			void appendFlattened(std::string_view text) {
+				std::size_t copied = 0;
+				for(std::size_t i = 0; i < text.size(); ) {
+					if(!isIdentifierChar(text[i])) {
+						++i;
+						continue;
+					}
+					std::size_t end = i;
+					while(end < text.size() && isIdentifierChar(text[end])) {
+						++end;
+					}
+					bool qualified = i >= 2 && text.compare(i - 2, 2, "::") == 0;
+					if(!qualified && text.compare(i, end - i, "std") == 0 && text.compare(end, 2, "::") == 0) {
+						std::size_t inner = end + 2, innerEnd = inner;
+						while(innerEnd < text.size() && isIdentifierChar(text[innerEnd])) {
+							++innerEnd;
+						}
+						if(isStdABINamespace(text.substr(inner, innerEnd - inner)) && text.compare(innerEnd, 2, "::") == 0) {
+							// Resume copying at the second `::`, so `std::__1::x` becomes `std::x`.
+							buffer.append(text, copied, end - copied);
+							copied = innerEnd;
+						}
+					}
+					i = end;
+				}
+				buffer.append(text, copied, std::string_view::npos);
+			}
+
+			/// Append `text` to `buffer`, flattened if `flatten`.
+			void append(std::string_view text, bool flatten) {
+				if(flatten) {
+					appendFlattened(text);
+				} else {
+					buffer.append(text);
+				}
+			}
+
+		public:
+			/**************************************************
+			 * Find the top-level arguments of the last
+			 * template argument list of `name` which isn't
+			 * nested in any brackets. Returns `false` if `name`
+			 * has no such list, or its brackets are unbalanced.
+			 **************************************************/
+			bool scan(std::string_view name) {
+				arguments.clear();
+				bool found = false;
+				std::size_t depth = 0, start = 0;
+				char outer = '\0';
+				for(std::size_t i = 0; i < name.size(); ++i) {
+					switch(name[i]) {
+						case '<': case '(': case '[': case '{':
+							if(!depth++) {
+								outer = name[i];
+								if(outer == '<') {
+									arguments.clear();
+									start = i + 1;
+								}
+							}
+							break;
+						case '>': case ')': case ']': case '}':
+							if(!depth) {
+								return false;
+							} else if(!--depth && outer == '<') {
+								if(name[i] != '>') {
+									return false;
+								}
+								arguments.push_back({start, i});
+								found = true;
+							}
+							break;
+						case ',':
+							if(depth == 1 && outer == '<') {
+								arguments.push_back({start, i});
+								start = i + 1;
+							}
+							break;
+					}
+				}
+				if(depth || !found) {
+					arguments.clear();
+					return false;
+				}
+				for(Argument& argument : arguments) {
+					while(argument.begin < argument.end && name[argument.begin] == ' ') {
+						++argument.begin;
+					}
+					while(argument.end > argument.begin && name[argument.end - 1] == ' ') {
+						--argument.end;
+					}
+				}
+				// `T<>` has no arguments, rather than one empty one.
+				if(arguments.size() == 1 && arguments[0].begin == arguments[0].end) {
+					arguments.clear();
+				}
+				return true;
+			}
+
+			/// The arguments found by the last call to `TypeNameRewriter::scan`.
+			const std::vector<Argument>& scanned() const {
+				return arguments;
+			}
+
+			/**************************************************
+			 * Rewrite `name`, replacing the `i`th scanned
+			 * argument with `replacements[i]` for `i < count`
+			 * (unless it's null), and flattening inline ABI
+			 * namespaces throughout if `flatten`. Unless `count`
+			 * is zero, `name` must have been passed to the last
+			 * call to `TypeNameRewriter::scan`. The result is
+			 * valid until the next call.
+			 **************************************************/
+			std::string_view rewrite(std::string_view name, const std::string_view *replacements, std::size_t count, bool flatten) {
+				buffer.clear();
+				std::size_t copied = 0;
+				for(std::size_t i = 0; i < arguments.size() && i < count; ++i) {
+					if(replacements[i].data()) {
+						append(name.substr(copied, arguments[i].begin - copied), flatten);
+						append(replacements[i], flatten);
+						copied = arguments[i].end;
+					}
+				}
+				append(name.substr(copied), flatten);
+				return buffer;
+			}
+		};
+
+		/// A `TypeNameRewriter` for the calling thread, so that its buffers are reused.
+		inline TypeNameRewriter& typeNameRewriter() {
+			static thread_local TypeNameRewriter ans;
+			return ans;
+		}
+	}
+}
@@ -19,12 +19,18 @@
  *
  ************************************************************************************/
 
-#include <boost/mpl/transform.hpp>
-#include <boost/mpl/vector.hpp>
-
+#include <boost/smart_ptr/intrusive_ptr.hpp>
 #include <boost/tti/has_type.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include <cxx-ffi/type_list.hpp>
 
 /******************************************************
  * Tools to generate a description of an API's class
@@ -42,7 +48,72 @@ namespace CxxFFI {
 	BOOST_TTI_HAS_TYPE(ReflBases);
 	
 	/// A helper type for client code to expose any base classes that should be in the public API
-	template<typename ...Bases> using DefineBases = boost::mpl::vector<Bases...>;
+	template<typename ...Bases> using DefineBases = TypeList<Bases...>;
+	
+	/**************************************************
+	 * Opt-in trait for handle templates `H<T>` which hold
+	 * a single pointer to a `T` and are covariant in `T`
+	 * (see `CoVariantBases`). Specializations must derive
+	 * from `std::true_type` and provide, for a handle `H<T>`:
+	 * <pre class="markdeep">
+	 * ```c++
+	 * using element_type = T;
+	 * template<typename U> using rebind = H<U>;
+	 * static T* get(const H<T>& handle);
+	 * // Release ownership of `handle`'s object to a new
+	 * // handle, referring to it through `target`.
+	 * template<typename U> static H<U> transfer(H<T>& handle, U* target);
+	 * ```
+	 * </pre>
+	 * Opting in supplies the `ReflBases`, `APIFilter`, 
+	 * `detail::IsHandle`, `detail::Upcaster`, and 
+	 * `detail::Downcaster` of every `H<T>`. Their casts 
+	 * allocate nothing: `upcast` and `downcast` retype the
+	 * handle in place (see `CastRetypesInPlace`), which
+	 * requires `H<T>` and `H<U>` to have the same size and
+	 * alignment, and `upcastInto` copies the handle if it
+	 * is copyable, and otherwise moves from it.
+	 * 
+	 * Provided for `std::unique_ptr` (with the default 
+	 * deleter) and `boost::intrusive_ptr`. `std::shared_ptr`
+	 * doesn't opt in, since it heap-allocates its results to
+	 * leave the argument intact.
+	 **************************************************/
+	template<typename H> struct CovariantHandle : std::false_type {};
+	
+	/// Specialization of `CovariantHandle` for `std::unique_ptr`, whose casts transfer ownership.
+	template<typename T> struct CovariantHandle<std::unique_ptr<T>> : std::true_type {
+		using element_type = T; ///< The type of object owned.
+		template<typename U> using rebind = std::unique_ptr<U>; ///< The handle for a `U`.
+		
+		/// The object owned by `handle`.
+		static T* get(const std::unique_ptr<T>& handle) {
+			return handle.get();
+		}
+		
+		/// Release ownership of `handle`'s object to a handle referring to it as `target`.
+		template<typename U> static std::unique_ptr<U> transfer(std::unique_ptr<T>& handle, U* target) {
+			handle.release();
+			return std::unique_ptr<U>(target);
+		}
+	};
+	
+	/// Specialization of `CovariantHandle` for `boost::intrusive_ptr`, whose casts move the reference rather than touching the count.
+	template<typename T> struct CovariantHandle<boost::intrusive_ptr<T>> : std::true_type {
+		using element_type = T; ///< The type of object referred to.
+		template<typename U> using rebind = boost::intrusive_ptr<U>; ///< The handle for a `U`.
+		
+		/// The object referred to by `handle`.
+		static T* get(const boost::intrusive_ptr<T>& handle) {
+			return handle.get();
+		}
+		
+		/// Move `handle`'s reference to a handle referring to its object as `target`.
+		template<typename U> static boost::intrusive_ptr<U> transfer(boost::intrusive_ptr<T>& handle, U* target) {
+			handle.detach();
+			return boost::intrusive_ptr<U>(target, false);
+		}
+	};
 	
 	/**************************************************
 	 * Internal implementation details
@@ -57,11 +128,17 @@ namespace CxxFFI {
 		template<typename T> struct MaybeBases<T, false> {
 			using type = DefineBases<>;
 		};
+		
+		/// Default implementation of `CxxFFI::ReflBases`, dispatching on `CovariantHandle`.
+		template<typename T, bool handle = CovariantHandle<T>::value> struct DefaultBases {
+			using type = typename MaybeBases<T>::type;
+		};
 	}
 	
 	/**************************************************
 	 * Metafunction returning the reflected base classes 
-	 * for `T`. All structs and classes cooperating with 
+	 * for `T`, as a `TypeList` (or, for compatibility,
+	 * any `boost::mpl` sequence). All structs and classes cooperating with 
 	 * #CXXFFI_EXPOSE should include boilerplate of the 
 	 * form:
 	 * <pre class="markdeep">
@@ -72,14 +149,25 @@ namespace CxxFFI {
 	 * };
 	 * ```
 	 * </pre>
-	 * Default implementation is via `detail::MaybeBases`.
+	 * Default implementation is via `detail::MaybeBases`,
+	 * or `CoVariantBases` for `CovariantHandle`s.
 	 * Client code may provide specializations to
 	 * implement more complex typing rules.
 	 **************************************************/
 	template<typename T> struct ReflBases {
-		using type = typename detail::MaybeBases<T>::type;
+		using type = typename detail::DefaultBases<T>::type;
 	};
 	
+	namespace detail {
+		/// Metafunction to instantiate `PType` with each element of the `TypeList` `Bases`.
+		template<template<typename Tp> class PType, typename Bases> struct ApplyEach;
+		
+		/// Implementation of `ApplyEach`.
+		template<template<typename Tp> class PType, typename ...Bases> struct ApplyEach<PType, TypeList<Bases...>> {
+			using type = TypeList<PType<Bases>...>; ///< `PType<Bases>...`
+		};
+	}
+	
 	/**************************************************
 	 * Metafunction implementing covariant typing rules
 	 * for templated classes.
@@ -99,7 +187,7 @@ namespace CxxFFI {
 	 * bare pointers.
 	 **************************************************/
 	template<template<typename Tp> class PType, typename T> struct CoVariantBases {
-		using type = typename boost::mpl::transform<typename ReflBases<T>::type, PType<boost::mpl::_1>>::type;
+		using type = typename detail::ApplyEach<PType, AsTypeList<typename ReflBases<T>::type>>::type;
 	};
 	
 	/// Specialiation of `ReflBases` for `std::shared_ptr` using `CoVariantBases`.
@@ -108,26 +196,369 @@ namespace CxxFFI {
 	};
 	
 	namespace detail {
+		/// Specialization of `DefaultBases` for `CovariantHandle`s, using `CoVariantBases`.
+		template<typename T> struct DefaultBases<T, true> {
+			using type = typename CoVariantBases<CovariantHandle<T>::template rebind, typename CovariantHandle<T>::element_type>::type;
+		};
+		
+		/**************************************************
+		 * Whether `Base` is an accessible, unambiguous base 
+		 * of `Derived` (or the same type), so that `Derived*`
+		 * converts implicitly to `Base*`. This conversion never
+		 * consults RTTI: a non-virtual base is a constant
+		 * offset, and a virtual base is a load of the offset
+		 * from `Derived`'s vtable.
+		 **************************************************/
+		template<typename Derived, typename Base> struct IsStaticUpcast : std::is_convertible<Derived*, Base*> {};
+		
+		/// Default implementation of `IsNonVirtualBase`, for when `static_cast<Derived*>(Base*)` is ill-formed.
+		template<typename Derived, typename Base, typename = void> struct IsNonVirtualBase : std::false_type {};
+		
+		/**************************************************
+		 * Whether `Base` is an accessible, unambiguous, 
+		 * non-virtual (direct or indirect) base of `Derived`,
+		 * in which case the offset of `Base` within `Derived`
+		 * is a compile-time constant. Detected via the 
+		 * well-formedness of `static_cast<Derived*>(Base*)`,
+		 * which is ill-formed if any step from `Derived` to
+		 * `Base` is virtual.
+		 **************************************************/
+		template<typename Derived, typename Base>
+		struct IsNonVirtualBase<Derived, Base, std::void_t<decltype(static_cast<Derived*>(std::declval<Base*>()))>>
+		: std::bool_constant<std::is_base_of<Base, Derived>::value && !std::is_same<Derived, Base>::value && IsStaticUpcast<Derived, Base>::value> {};
+		
+		/**************************************************
+		 * The constant byte offset of the `Base` subobject
+		 * within any `Derived`. Computed by converting a 
+		 * pointer into suitably aligned storage, which never
+		 * dereferences it since no step is virtual.
+		 **************************************************/
+		template<typename Derived, typename Base> std::ptrdiff_t baseOffset() {
+			static_assert(IsNonVirtualBase<Derived, Base>::value, "Only non-virtual bases have a constant offset");
+			alignas(Derived) static unsigned char storage[sizeof(Derived)];
+			Derived *derived = reinterpret_cast<Derived*>(storage);
+			return reinterpret_cast<unsigned char*>(static_cast<Base*>(derived)) - storage;
+		}
+		
 		/// Default implementation of a cast from `Derived` to `Base`, assuming `Derived : Base`.
-		template<typename Derived, typename Base> struct Upcaster {
+		template<typename Derived, typename Base, bool handles = CovariantHandle<Derived>::value && CovariantHandle<Base>::value> struct Upcaster {
 			static Base* apply(Derived* derived){
 				return derived;
 			}
 		};
 		
-		/// Specialization of `Upcaster` for emulated covariance in `std::shared_ptr` using `std::dynamic_pointer_cast`
+		/**************************************************
+		 * Specialization of `Upcaster` for emulated covariance
+		 * in `std::shared_ptr`. Uses the implicit (static)
+		 * conversion whenever `detail::IsStaticUpcast` holds,
+		 * which costs a pointer adjustment and a refcount bump.
+		 * Falls back to `std::dynamic_pointer_cast` only when
+		 * client code reflects a base that C++ can't reach
+		 * statically (e.g. an ambiguous base, or a relation 
+		 * declared via a `ReflBases` specialization which is
+		 * a cross-cast at runtime).
+		 **************************************************/
 		template<typename Derived, typename Base>
 		struct Upcaster<std::shared_ptr<Derived>, std::shared_ptr<Base>> {
+			/// Convert `derived` to a `std::shared_ptr<Base>` sharing ownership.
+			static std::shared_ptr<Base> convert(const std::shared_ptr<Derived>& derived) {
+				if constexpr (IsStaticUpcast<Derived, Base>::value) {
+					return derived;
+				} else {
+					return std::dynamic_pointer_cast<Base>(derived);
+				}
+			}
+			
+			/// Return a new heap-allocated handle, which the caller must `delete`.
 			static std::shared_ptr<Base>* apply(std::shared_ptr<Derived>* derived) {
-				// We should really add an extra branch in here to check if we can use a static_pointer_cast instead
-				// but this is simpler for now, and deals with multiple inheritance
-				return new std::shared_ptr<Base>(std::dynamic_pointer_cast<Base>(*derived));
+				return new std::shared_ptr<Base>(convert(*derived));
+			}
+			
+			/// Construct the handle in `storage`, which the caller must release with `CxxFFI::destroy`.
+			static std::shared_ptr<Base>* applyInto(std::shared_ptr<Derived>* derived, void* storage) {
+				return new (storage) std::shared_ptr<Base>(convert(*derived));
+			}
+		};
+		
+		/**************************************************
+		 * Retype the `From` handle at `from` in place as a `To`
+		 * handle referring to its object as `target`, which
+		 * must be the same object, consuming `*from`, and 
+		 * return the result, at the same address.
+		 **************************************************/
+		template<typename To, typename From> To* retypeHandle(From* from, typename CovariantHandle<To>::element_type* target) {
+			static_assert(sizeof(From) == sizeof(To) && alignof(From) == alignof(To), "Covariant handles must be retyped in place");
+			To moved = CovariantHandle<From>::transfer(*from, target);
+			from->~From();
+			return new (static_cast<void*>(from)) To(std::move(moved));
+		}
+		
+		/**************************************************
+		 * Specialization of `Upcaster` for `CovariantHandle`s,
+		 * which never allocates. Like that for `std::shared_ptr`,
+		 * it falls back to `dynamic_cast` only for bases C++
+		 * can't reach statically.
+		 **************************************************/
+		template<typename Derived, typename Base> struct Upcaster<Derived, Base, true> {
+			using DerivedElement = typename CovariantHandle<Derived>::element_type; ///< The type `Derived` refers to.
+			using BaseElement = typename CovariantHandle<Base>::element_type; ///< The type `Base` refers to.
+			
+			/// The object `derived` refers to as a `BaseElement`, or `nullptr` if there is none.
+			static BaseElement* target(const Derived& derived) {
+				DerivedElement *element = CovariantHandle<Derived>::get(derived);
+				if constexpr (IsStaticUpcast<DerivedElement, BaseElement>::value) {
+					return element;
+				} else {
+					return dynamic_cast<BaseElement*>(element);
+				}
+			}
+			
+			/// Retype `*derived` in place, consuming it, and return it. Returns `nullptr`, leaving `*derived` intact, if `derived` is null or a `dynamic_cast` fails.
+			static Base* apply(Derived* derived) {
+				if(!derived) {
+					return nullptr;
+				}
+				BaseElement *element = target(*derived);
+				if(!element && CovariantHandle<Derived>::get(*derived)) {
+					return nullptr;
+				}
+				return retypeHandle<Base>(derived, element);
 			}
+			
+			/// Construct the handle in `storage`, which the caller must release with `CxxFFI::destroy`, copying `*derived` if possible, and otherwise moving from it. Returns `nullptr`, constructing nothing, if a `dynamic_cast` fails.
+			static Base* applyInto(Derived* derived, void* storage) {
+				BaseElement *element = target(*derived);
+				if(!element && CovariantHandle<Derived>::get(*derived)) {
+					return nullptr;
+				}
+				if constexpr (std::is_copy_constructible<Derived>::value) {
+					Derived copy(*derived);
+					return new (storage) Base(CovariantHandle<Derived>::transfer(copy, element));
+				} else {
+					return new (storage) Base(CovariantHandle<Derived>::transfer(*derived, element));
+				}
+			}
+		};
+		
+		/**************************************************
+		 * Whether `T` is a handle type, whose `Upcaster`
+		 * produces a new object rather than adjusting a 
+		 * pointer. Handle types additionally support
+		 * `CxxFFI::upcastInto` and `CxxFFI::destroy`.
+		 **************************************************/
+		template<typename T> struct IsHandle : std::bool_constant<CovariantHandle<T>::value> {};
+		
+		/// Specialization of `IsHandle` for `std::shared_ptr`.
+		template<typename T> struct IsHandle<std::shared_ptr<T>> : std::true_type {};
+		
+		/// The class a pointer to `T` ultimately refers to: `T` itself, or the pointee of a handle type.
+		template<typename T, bool handle = CovariantHandle<T>::value> struct ElementType {
+			using type = T;
+		};
+		
+		/// Specialization of `ElementType` for `CovariantHandle`s.
+		template<typename T> struct ElementType<T, true> {
+			using type = typename CovariantHandle<T>::element_type;
+		};
+		
+		/// Specialization of `ElementType` for `std::shared_ptr`.
+		template<typename T> struct ElementType<std::shared_ptr<T>> {
+			using type = T;
 		};
+		
+		/**************************************************
+		 * Whether every reflected step above `T` is a single,
+		 * non-virtual base, so `T` and its reflected ancestors
+		 * form a chain rather than a DAG. Subtyping within such
+		 * chains is decided by interval numbering (see 
+		 * `detail::TypeIntervals`) instead of `dynamic_cast`.
+		 **************************************************/
+		template<typename T, typename Bases = AsTypeList<typename CxxFFI::ReflBases<T>::type>> struct IsSingleChain : std::false_type {};
+		
+		/// Specialization of `IsSingleChain` for roots.
+		template<typename T> struct IsSingleChain<T, TypeList<>> : std::true_type {};
+		
+		/// Specialization of `IsSingleChain` for a single reflected base.
+		template<typename T, typename Base> struct IsSingleChain<T, TypeList<Base>>
+		: std::bool_constant<IsNonVirtualBase<typename ElementType<T>::type, typename ElementType<Base>::type>::value && IsSingleChain<Base>::value> {};
+		
+		/**************************************************
+		 * Default implementation of a checked cast from `Base`
+		 * to `Derived`, assuming `Derived : Base` and that `Base`
+		 * is polymorphic. `Downcaster::convert` is only valid
+		 * once the dynamic type is known to be a `Derived`, and
+		 * only compiles for non-virtual paths; `Downcaster::check`
+		 * is always valid, and costs a `dynamic_cast`.
+		 **************************************************/
+		template<typename Base, typename Derived, bool handles = CovariantHandle<Base>::value && CovariantHandle<Derived>::value> struct Downcaster {
+			/// The dynamic type of `*base`, or `nullptr` if `base` is null.
+			static const std::type_info* dynamicType(Base* base) {
+				return base ? &typeid(*base) : nullptr;
+			}
+			
+			/// Adjust `base`, which must point into a `Derived`.
+			static Derived* convert(Base* base) {
+				return static_cast<Derived*>(base);
+			}
+			
+			/// Return `base` as a `Derived*`, or `nullptr` if it isn't one.
+			static Derived* check(Base* base) {
+				return dynamic_cast<Derived*>(base);
+			}
+		};
+		
+		/// Specialization of `Downcaster` for emulated covariance in `std::shared_ptr`. Results are heap-allocated, as by `Upcaster::apply`.
+		template<typename Base, typename Derived>
+		struct Downcaster<std::shared_ptr<Base>, std::shared_ptr<Derived>> {
+			/// The dynamic type of `**base`, or `nullptr` if `base` or `*base` is null.
+			static const std::type_info* dynamicType(std::shared_ptr<Base>* base) {
+				return base && *base ? &typeid(**base) : nullptr;
+			}
+			
+			/// Return a new handle sharing ownership with `*base`, which must point into a `Derived`.
+			static std::shared_ptr<Derived>* convert(std::shared_ptr<Base>* base) {
+				return new std::shared_ptr<Derived>(std::static_pointer_cast<Derived>(*base));
+			}
+			
+			/// Return a new handle sharing ownership with `*base`, or `nullptr` (allocating nothing) if it isn't a `Derived`.
+			static std::shared_ptr<Derived>* check(std::shared_ptr<Base>* base) {
+				if(!base) {
+					return nullptr;
+				}
+				std::shared_ptr<Derived> derived = std::dynamic_pointer_cast<Derived>(*base);
+				return derived ? new std::shared_ptr<Derived>(std::move(derived)) : nullptr;
+			}
+		};
+		
+		/// Specialization of `Downcaster` for `CovariantHandle`s, which never allocates: on success the handle is retyped in place, as by `Upcaster::apply`, and on failure it is left intact.
+		template<typename Base, typename Derived> struct Downcaster<Base, Derived, true> {
+			using DerivedElement = typename CovariantHandle<Derived>::element_type; ///< The type `Derived` refers to.
+			
+			/// The dynamic type of `**base`, or `nullptr` if `base` or `*base` is null.
+			static const std::type_info* dynamicType(Base* base) {
+				auto *element = base ? CovariantHandle<Base>::get(*base) : nullptr;
+				return element ? &typeid(*element) : nullptr;
+			}
+			
+			/// Retype `*base`, which must refer to a `DerivedElement`, in place.
+			static Derived* convert(Base* base) {
+				return retypeHandle<Derived>(base, static_cast<DerivedElement*>(CovariantHandle<Base>::get(*base)));
+			}
+			
+			/// Retype `*base` in place, or return `nullptr` (leaving it intact) if it doesn't refer to a `DerivedElement`.
+			static Derived* check(Base* base) {
+				DerivedElement *element = base ? dynamic_cast<DerivedElement*>(CovariantHandle<Base>::get(*base)) : nullptr;
+				return element ? retypeHandle<Derived>(base, element) : nullptr;
+			}
+		};
+		
+		/// Whether `downcast<Base, Derived>` can be instantiated, i.e. the dynamic type of a `Base` is observable.
+		template<typename Base, typename Derived> struct IsCheckedDowncast : std::is_polymorphic<typename ElementType<Base>::type> {};
 	}
 	
 	/// Must be instantiated for every pair of related types you want exposed in your FFI. See #CXXFFI_EXPOSE.
 	template<typename Derived, typename Base> Base* upcast(Derived* derived){
 		return detail::Upcaster<Derived, Base>::apply(derived);
 	}
+	
+	namespace detail {
+		/// Add `offset` to each non-null pointer in `in`, writing the results to `out`. Compilers won't vectorize loads of class pointers, so this operates on their integer representations.
+		inline void offsetPointers(const std::uintptr_t *in, std::uintptr_t *out, std::size_t n, std::uintptr_t offset) {
+			for(std::size_t i = 0; i < n; ++i) {
+				std::uintptr_t p = in[i];
+				out[i] = p ? p + offset : 0;
+			}
+		}
+	}
+	
+	/**************************************************
+	 * Batched variant of `upcast`, which converts `n` 
+	 * elements of `in` into `out` in a single call, to
+	 * amortize the cost of crossing the FFI boundary.
+	 * For raw pointers with a non-virtual path this is a
+	 * constant adjustment per element, which the compiler
+	 * can vectorize. For handle types each element of
+	 * `out` is produced exactly as by `upcast`.
+	 **************************************************/
+	template<typename Derived, typename Base> void upcastN(Derived* const* in, Base** out, std::size_t n){
+		if constexpr (detail::IsNonVirtualBase<Derived, Base>::value) {
+			detail::offsetPointers(reinterpret_cast<const std::uintptr_t*>(in), reinterpret_cast<std::uintptr_t*>(out), n, detail::baseOffset<Derived, Base>());
+		} else {
+			for(std::size_t i = 0; i < n; ++i) {
+				out[i] = detail::Upcaster<Derived, Base>::apply(in[i]);
+			}
+		}
+	}
+	
+	/**************************************************
+	 * The machine code of every raw pointer `upcast` whose
+	 * base is at the constant byte offset `Offset`: null
+	 * maps to null, and anything else is advanced by 
+	 * `Offset`. #CXXFFI_EXPOSE points such upcasts at one
+	 * instantiation of this per offset, rather than 
+	 * instantiating `upcast` for every pair of types (see
+	 * #CXXFFI_SHARED_UPCAST_LIMIT). It is called through
+	 * the C ABI, in which all object pointers are passed
+	 * alike, as `Base*(*)(Derived*)`.
+	 **************************************************/
+	template<std::size_t Offset> void* upcastByOffset(void* derived){
+		return derived ? static_cast<unsigned char*>(derived) + Offset : nullptr;
+	}
+	
+	/// Batched variant of `upcastByOffset`, which likewise stands in for `upcastN`.
+	template<std::size_t Offset> void upcastNByOffset(void* const* in, void** out, std::size_t n){
+		detail::offsetPointers(reinterpret_cast<const std::uintptr_t*>(in), reinterpret_cast<std::uintptr_t*>(out), n, Offset);
+	}
+	
+	/**************************************************
+	 * Variant of `upcast` for handle types (see 
+	 * `detail::IsHandle`), which constructs the result in
+	 * caller-provided `storage` instead of on the heap.
+	 * `storage` must be valid for `sizeof(Base)` bytes 
+	 * and aligned to `alignof(Base)`, as reported in the
+	 * binary casts table. Release the result with `destroy`.
+	 **************************************************/
+	template<typename Derived, typename Base> Base* upcastInto(Derived* derived, void* storage){
+		static_assert(detail::IsHandle<Base>::value, "upcastInto is only meaningful for handle types");
+		return detail::Upcaster<Derived, Base>::applyInto(derived, storage);
+	}
+	
+	/**************************************************
+	 * The inverse of `upcast`: return `base` as a `Derived`,
+	 * or `nullptr` if its dynamic type isn't a `Derived`. 
+	 * For handle types the result is produced as by
+	 * `upcast`, and nothing is allocated on failure. `Base`
+	 * (or its pointee) must be polymorphic.
+	 * 
+	 * If `Index` is a `CastsTable`, and the path from `Derived`
+	 * up to `Base` is non-virtual, then whenever the dynamic 
+	 * type is in the table and `detail::IsSingleChain` holds
+	 * for it, the check is an O(1) comparison of interval
+	 * numbers followed by a constant adjustment. Otherwise 
+	 * (multiple or virtual inheritance, types unknown to the
+	 * table, or no `Index`) it falls back to `dynamic_cast`.
+	 **************************************************/
+	template<typename Base, typename Derived, typename Index = void> Derived* downcast(Base* base){
+		static_assert(detail::IsCheckedDowncast<Base, Derived>::value, "downcast requires a polymorphic base");
+		using Caster = detail::Downcaster<Base, Derived>;
+		using DerivedElement = typename detail::ElementType<Derived>::type;
+		if constexpr (!std::is_void<Index>::value && detail::IsNonVirtualBase<DerivedElement, typename detail::ElementType<Base>::type>::value) {
+			const std::type_info *dynamic = Caster::dynamicType(base);
+			if(!dynamic) {
+				return nullptr;
+			}
+			const auto& intervals = Index::typeIntervals();
+			static const std::uint32_t target = intervals.typeId(typeid(DerivedElement), detail::IsHandle<Derived>::value);
+			std::uint32_t actual = intervals.typeId(*dynamic, detail::IsHandle<Derived>::value);
+			if(intervals.chained(target) && intervals.chained(actual)) {
+				return intervals.contains(target, actual) ? Caster::convert(base) : nullptr;
+			}
+		}
+		return Caster::check(base);
+	}
+	
+	/// Destroy a handle constructed by `upcastInto`, without freeing its storage.
+	template<typename T> void destroy(T* handle){
+		handle->~T();
+	}
 }
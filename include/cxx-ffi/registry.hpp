@@ -0,0 +1,303 @@
+#pragma once
+/************************************************************************************
+ * @file registry.hpp
+ * A process-wide registry which every exposed casts table joins as its library is
+ * loaded, so that the tables in each image share a single scan of its symbols, and
+ * FFIs can obtain merged or per-library views of every table in the process.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <cxx-ffi/image_symbols.hpp>
+#include <cxx-ffi/json_writer.hpp>
+
+namespace CxxFFI {
+	/******************************************************
+	 * Statistics for the process-wide `Registry`, as
+	 * returned by `cxxffi_registry_stats()`. All fields are
+	 * `uint64_t`, so the equivalent C declaration is
+	 * obtained by replacing `std::uint64_t` with `uint64_t`.
+	 ******************************************************/
+	struct RegistryStats {
+		std::uint64_t structSize; ///< `sizeof(RegistryStats)`, to permit appending fields in later versions.
+		std::uint64_t tables; ///< Number of casts tables currently joined.
+		std::uint64_t images; ///< Number of images whose symbols have been indexed.
+		std::uint64_t imageScans; ///< Number of times an image's symbols were scanned.
+		std::uint64_t sharedScans; ///< Number of times a table reused the scan of its image made for another table.
+	};
+
+	static_assert(std::is_standard_layout<RegistryStats>::value && std::is_trivially_copyable<RegistryStats>::value, "RegistryStats must be usable from C");
+
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/// The upcasts exported by one image, and the cost of finding them.
+		struct ImageUpcasts {
+			std::map<std::string, std::map<std::string, std::string> > casts; ///< The (mangled) symbols of the upcasts between every pair of types, keyed by their demangled names, derived first.
+			std::uint64_t symbolLoadNs = 0; ///< See `CastsTableStats::symbolLoadNs`.
+			std::uint64_t matchNs = 0; ///< See `CastsTableStats::matchNs`.
+			std::uint64_t demangleNs = 0; ///< See `CastsTableStats::demangleNs`.
+			std::uint64_t symbolsScanned = 0; ///< See `CastsTableStats::symbolsScanned`.
+			std::uint64_t symbolsDemangled = 0; ///< See `CastsTableStats::symbolsDemangled`.
+			std::uint64_t symbolsMatched = 0; ///< See `CastsTableStats::symbolsMatched`.
+		};
+
+		/// One type of a joined table, and the upcasts from it whose symbols were found. The views refer to the table's memoized names and symbols.
+		struct RegistryType {
+			std::string_view name; ///< The API name of the type.
+			std::vector<std::pair<std::string_view, std::string_view>> upcasts; ///< The API name of each base, and the (mangled) symbol of the upcast to it.
+		};
+	}
+
+	/******************************************************
+	 * The casts tables in the process, and an index of the
+	 * upcasts in each of their images. Every table generated
+	 * by #CXXFFI_EXPOSE or #CXXFFI_EXPOSE_REGISTERED joins
+	 * when its library is loaded, which costs no more than
+	 * recording it, and leaves when it is unloaded. The
+	 * first table in an image to need its symbols scans
+	 * them for every upcast, and the other tables in the
+	 * image filter that index, rather than scanning again.
+	 *
+	 * Since the library is header-only, the registry is
+	 * shared between libraries by the dynamic linker, which
+	 * unifies the function-local static of `Registry::instance`
+	 * (as an `STB_GNU_UNIQUE` symbol under GCC) between
+	 * libraries which export it, even if loaded with
+	 * `RTLD_LOCAL`. Libraries built with hidden visibility
+	 * each get their own registry, and all libraries sharing
+	 * one must be built against the same version of it.
+	 ******************************************************/
+	class Registry {
+	public:
+		/// A casts table which has joined the registry.
+		struct Table {
+			std::string name; ///< The `NAME` it was exposed as.
+			const void *image; ///< The base address of its library (see `detail::imageBase`).
+			std::vector<detail::RegistryType> (*describe)(); ///< Generates its types and the symbols of their upcasts, on demand.
+		};
+
+	private:
+		/// The index of one image, which is built at most once.
+		struct Image {
+			std::once_flag indexed; ///< Guards `Image::upcasts`.
+			detail::ImageUpcasts upcasts; ///< The upcasts in the image.
+			std::size_t tables = 0; ///< The number of joined tables in the image.
+		};
+
+		mutable std::mutex mutex; ///< Guards everything below.
+		std::map<const void*, std::unique_ptr<Image>> images; ///< Keyed by image base address, so entries never move.
+		std::map<std::uint64_t, Table> tables; ///< Keyed by the token returned from `Registry::join`, so in order of joining.
+		std::uint64_t nextToken = 0; ///< The token for the next table to join.
+		std::uint64_t generation = 0; ///< Incremented whenever a table joins or leaves, invalidating the views.
+		std::map<std::pair<const void*, std::uint64_t>, std::string> views; ///< Every view generated, keyed by image (or `nullptr` for all) and generation, and kept for the lifetime of the process.
+		RegistryStats stats = {sizeof(RegistryStats)}; ///< See `Registry::statistics`.
+
+		Registry() = default;
+
+		/// Find or create the entry for `image`. Must be called with `mutex` held.
+		Image& entry(const void *image) {
+			std::unique_ptr<Image>& ans = images[image];
+			if(!ans) {
+				ans = std::make_unique<Image>();
+			}
+			return *ans;
+		}
+
+		/// Emit `types` as a JSON casts table, in the same format as `CastsTable::castsTable`.
+		template<typename Sink> static void emitTypes(Sink& sink, const std::vector<const detail::RegistryType*>& types) {
+			sink.raw("{");
+			for(std::size_t i = 0; i < types.size(); ++i) {
+				sink.raw("\n\t");
+				sink.quoted(types[i]->name);
+				sink.raw(" : {");
+				const std::vector<std::pair<std::string_view, std::string_view>>& upcasts = types[i]->upcasts;
+				for(std::size_t j = 0; j < upcasts.size(); ++j) {
+					sink.raw("\n\t\t");
+					sink.quoted(upcasts[j].first);
+					sink.raw(" : ");
+					sink.quoted(upcasts[j].second);
+					sink.raw(j + 1 != upcasts.size() ? ", " : "");
+				}
+				sink.raw("}");
+				sink.raw(i + 1 != types.size() ? ", " : "");
+			}
+			sink.raw("}");
+		}
+
+		/// Merge the types of `joined`, keeping the first occurrence of each type, and of each upcast from it, in order of joining.
+		static std::string merge(const std::vector<Table>& joined) {
+			std::vector<std::vector<detail::RegistryType>> described;
+			for(const Table& table : joined) {
+				described.push_back(table.describe());
+			}
+			std::vector<const detail::RegistryType*> order;
+			std::map<std::string_view, detail::RegistryType> merged;
+			std::set<std::pair<std::string_view, std::string_view>> seen;
+			for(const std::vector<detail::RegistryType>& types : described) {
+				for(const detail::RegistryType& type : types) {
+					auto [it, fresh] = merged.try_emplace(type.name, detail::RegistryType{type.name, {}});
+					if(fresh) {
+						order.push_back(&it->second);
+					}
+					for(const std::pair<std::string_view, std::string_view>& upcast : type.upcasts) {
+						if(seen.emplace(type.name, upcast.first).second) {
+							it->second.upcasts.push_back(upcast);
+						}
+					}
+				}
+			}
+			return detail::writeJson([&](auto& sink) {
+				emitTypes(sink, order);
+			});
+		}
+
+	public:
+		Registry(const Registry&) = delete;
+		Registry& operator=(const Registry&) = delete;
+
+		/// The registry for the process. It is never destroyed, so tables may leave it during static destruction in any order.
+		static Registry& instance() {
+			static Registry *ans = new Registry();
+			return *ans;
+		}
+
+		/// Record `table`, returning a token with which it can leave.
+		std::uint64_t join(Table table) {
+			std::lock_guard<std::mutex> lock(mutex);
+			++entry(table.image).tables;
+			std::uint64_t token = nextToken++;
+			tables.emplace(token, std::move(table));
+			++generation;
+			++stats.tables;
+			return token;
+		}
+
+		/// Forget the table which joined with `token`, and the index of its image if no other tables remain there (since it may be unloaded).
+		void leave(std::uint64_t token) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto table = tables.find(token);
+			if(table == tables.end()) {
+				return;
+			}
+			auto image = images.find(table->second.image);
+			if(image != images.end() && !--image->second->tables) {
+				images.erase(image);
+			}
+			tables.erase(table);
+			++generation;
+			--stats.tables;
+		}
+
+		/**************************************************
+		 * Obtain the index of the upcasts in the image whose
+		 * base address is `image`, calling `scan` to build it
+		 * if no other table has, and setting `shared` to
+		 * whether it had been. Concurrent callers for the same
+		 * image wait for a single scan. `scan` must find the
+		 * upcasts between every pair of types in the image.
+		 **************************************************/
+		const detail::ImageUpcasts& imageUpcasts(const void *image, detail::ImageUpcasts (*scan)(), bool& shared) {
+			Image *here;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				here = &entry(image);
+			}
+			bool scanned = false;
+			std::call_once(here->indexed, [&]() {
+				here->upcasts = scan();
+				scanned = true;
+			});
+			shared = !scanned;
+			std::lock_guard<std::mutex> lock(mutex);
+			if(scanned) {
+				++stats.images;
+				++stats.imageScans;
+			} else {
+				++stats.sharedScans;
+			}
+			return here->upcasts;
+		}
+
+		/**************************************************
+		 * A JSON casts table, in the same format as those of
+		 * the individual tables, merging every joined table
+		 * in the image whose base address is `image`, or in
+		 * the process if `image` is `nullptr`. Each type, and
+		 * each upcast from it, appears once, however many
+		 * tables expose it, and only upcasts whose symbols
+		 * were found are included. Since every instantiation
+		 * of an upcast is equivalent, its symbol may be
+		 * resolved with `dlsym(RTLD_DEFAULT, ...)` or in any
+		 * library which exposes it. The result remains valid
+		 * for the lifetime of the process.
+		 **************************************************/
+		const std::string& castsTable(const void *image = nullptr) {
+			std::vector<Table> joined;
+			std::pair<const void*, std::uint64_t> key;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				key = {image, generation};
+				auto view = views.find(key);
+				if(view != views.end()) {
+					return view->second;
+				}
+				for(const std::pair<const std::uint64_t, Table>& table : tables) {
+					if(!image || table.second.image == image) {
+						joined.push_back(table.second);
+					}
+				}
+			}
+			// Describing the tables may generate them, which needs the lock.
+			std::string merged = merge(joined);
+			std::lock_guard<std::mutex> lock(mutex);
+			return views.emplace(key, std::move(merged)).first->second;
+		}
+
+		/// A consistent copy of the statistics so far.
+		RegistryStats statistics() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return stats;
+		}
+	};
+
+	namespace detail {
+		/// Joins a table to the `Registry` on construction, and leaves on destruction. As a static, this happens as its library is loaded and unloaded.
+		class RegistryMembership {
+			std::uint64_t token; ///< See `Registry::join`.
+		public:
+			explicit RegistryMembership(Registry::Table table) : token(Registry::instance().join(std::move(table))) {}
+			RegistryMembership(const RegistryMembership&) = delete;
+			RegistryMembership& operator=(const RegistryMembership&) = delete;
+			~RegistryMembership() {
+				Registry::instance().leave(token);
+			}
+		};
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+/************************************************************************************
+ * @file subtype_matrix.hpp
+ * A dense bitset matrix of the subtype relation between the types of a casts table,
+ * computed entirely at compile time, so FFIs can answer is-a queries in O(1).
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <cxx-ffi/type_list.hpp>
+
+namespace CxxFFI {
+	/******************************************************
+	 * Header of the subtype matrix returned by
+	 * `NAME_subtypes()`. It is immediately followed by
+	 * `typeCount * rowWords` 64-bit words: row `a` starts
+	 * at word `a * rowWords`, and bit `b % 64` of word
+	 * `b / 64` in that row is set iff type id `a` is a
+	 * subtype of (or the same as) type id `b`. Type ids
+	 * are those of the binary casts table. All integers
+	 * are in native byte order. The equivalent C
+	 * declaration is obtained by replacing `std::uint32_t`
+	 * with `uint32_t`.
+	 ******************************************************/
+	struct SubtypeMatrixHeader {
+		char magic[8]; ///< Always `"CXXFFISM"` (not NUL-terminated).
+		std::uint32_t version; ///< See `SubtypeMatrixHeader::currentVersion`.
+		std::uint32_t headerSize; ///< `sizeof(SubtypeMatrixHeader)`; the words begin at this offset.
+		std::uint32_t typeCount; ///< Number of rows (and of meaningful columns).
+		std::uint32_t rowWords; ///< Number of 64-bit words per row, i.e. `(typeCount + 63) / 64`.
+
+		static constexpr std::uint32_t currentVersion = 1; ///< The layout version written by this header.
+	};
+
+	static_assert(std::is_standard_layout<SubtypeMatrixHeader>::value && sizeof(SubtypeMatrixHeader) == 24, "SubtypeMatrixHeader must have a stable layout");
+
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/******************************************************
+		 * The subtype matrix of a `TypeList` of toposorted,
+		 * filtered hierarchies (`CastsTable::HierarchyFiltered`),
+		 * as a constant expression. The most derived type of
+		 * each hierarchy gets the type id of its position, as
+		 * in `HierarchyDescription::types`, and is a subtype of
+		 * exactly the types in its hierarchy.
+		 ******************************************************/
+		template<typename Hierarchies> struct SubtypeMatrix;
+
+		/// Implementation of `SubtypeMatrix`.
+		template<typename ...Hierarchies> struct SubtypeMatrix<TypeList<Hierarchies...>> {
+			static constexpr std::size_t typeCount = sizeof...(Hierarchies); ///< The number of types.
+			static constexpr std::size_t rowWords = (typeCount + 63) / 64; ///< The number of words per row.
+			static constexpr std::size_t wordCount = typeCount * rowWords ? typeCount * rowWords : 1; ///< The number of words, padded so the array is never empty.
+
+			/// The header and the words, laid out contiguously as described by `SubtypeMatrixHeader`.
+			struct Buffer {
+				SubtypeMatrixHeader header;
+				std::uint64_t words[wordCount];
+			};
+			static_assert(offsetof(Buffer, words) == sizeof(SubtypeMatrixHeader), "The words must immediately follow the header");
+
+			/// Set the bits of row `row` for the types in `Hierarchy`.
+			template<typename Hierarchy> static constexpr void setRow(Buffer& buffer, std::size_t row) {
+				constexpr bool related[] = {false, Contains<Hierarchy, Front<Hierarchies>>...};
+				for(std::size_t column = 0; column < typeCount; ++column) {
+					if(related[column + 1]) {
+						buffer.words[row * rowWords + column / 64] |= std::uint64_t(1) << (column % 64);
+					}
+				}
+			}
+
+			/// Compute the whole buffer.
+			static constexpr Buffer build() {
+				Buffer buffer = {{{'C', 'X', 'X', 'F', 'F', 'I', 'S', 'M'}, SubtypeMatrixHeader::currentVersion, sizeof(SubtypeMatrixHeader), std::uint32_t(typeCount), std::uint32_t(rowWords)}, {}};
+				std::size_t row = 0;
+				(setRow<Hierarchies>(buffer, row++), ...);
+				return buffer;
+			}
+
+			static constexpr Buffer buffer = build(); ///< The matrix, in read-only data.
+
+			/// Whether type id `derived` is a subtype of (or the same as) type id `base`. Unknown ids are unrelated.
+			static constexpr bool isSubtype(std::uint32_t derived, std::uint32_t base) {
+				return derived < typeCount && base < typeCount && (buffer.words[derived * rowWords + base / 64] >> (base % 64)) & 1;
+			}
+		};
+	}
+}
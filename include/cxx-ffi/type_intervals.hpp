@@ -0,0 +1,148 @@
+#pragma once
+/************************************************************************************
+ * @file type_intervals.hpp
+ * Pre/post-order interval numbering of the single-inheritance chains in a casts
+ * table, so that `CxxFFI::downcast` can decide subtyping in constant time.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <cstdint>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cxx-ffi/cast_lookup.hpp>
+
+namespace CxxFFI {
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/******************************************************
+		 * Numbers the types of a casts table for which
+		 * `detail::IsSingleChain` holds. Those types form a
+		 * forest, in which each type's parent is its nearest
+		 * ancestor in the table, so a DFS assigns each one an
+		 * interval `[pre, post]` nested inside its ancestors'
+		 * and disjoint from everything else. `A` is then an
+		 * ancestor of (or equal to) `D` iff `A`'s interval
+		 * contains `D`'s. Types outside the forest have no
+		 * interval, and must be checked with `dynamic_cast`.
+		 * Type ids are assigned in order of `TypeIntervals::addType`,
+		 * which `CastsTable` keeps consistent with the binary table.
+		 ******************************************************/
+		class TypeIntervals {
+		public:
+			/// A DFS interval, or `{noTypeId, noTypeId}` for types outside the forest.
+			struct Interval {
+				std::uint32_t pre = noTypeId; ///< Visit order on entering the type.
+				std::uint32_t post = noTypeId; ///< Visit order on leaving the type, after all its descendants.
+			};
+
+		private:
+			std::unordered_map<std::type_index, std::uint32_t> ids[2]; ///< Type ids keyed by the type of the object referred to, for raw classes and handle types respectively.
+			std::vector<bool> chains; ///< Whether each type is in the forest.
+			std::vector<std::uint32_t> parents; ///< The parent of each type in the forest, or `noTypeId` for roots.
+			std::vector<Interval> intervals; ///< The interval of each type, once `TypeIntervals::finish` has run.
+
+		public:
+			/**
+			 * Add a type, returning its type id.
+			 * @param element The type of the object a pointer to this type refers to (see `detail::ElementType`).
+			 * @param handle Whether this is a handle type (see `detail::IsHandle`).
+			 * @param chained Whether `detail::IsSingleChain` holds for this type.
+			 */
+			std::uint32_t addType(const std::type_info& element, bool handle, bool chained) {
+				std::uint32_t id = chains.size();
+				ids[handle].emplace(element, id);
+				chains.push_back(chained);
+				parents.push_back(noTypeId);
+				return id;
+			}
+
+			/**
+			 * Record that type id `base` is an ancestor of type id `derived`.
+			 * Must follow every call to `TypeIntervals::addType`. The ancestors
+			 * of each type must be added nearest first, as they are in
+			 * `HierarchyDescription::upcasts`.
+			 */
+			void addBase(std::uint32_t derived, std::uint32_t base) {
+				if(chains[derived] && chains[base] && parents[derived] == noTypeId) {
+					parents[derived] = base;
+				}
+			}
+
+			/// Number the forest. Must follow every call to `TypeIntervals::addBase`.
+			void finish() {
+				std::vector<std::vector<std::uint32_t>> children(chains.size());
+				std::vector<std::uint32_t> roots;
+				for(std::uint32_t id = 0; id < chains.size(); ++id) {
+					if(!chains[id]) {
+						continue;
+					} else if(parents[id] == noTypeId) {
+						roots.push_back(id);
+					} else {
+						children[parents[id]].push_back(id);
+					}
+				}
+				intervals.assign(chains.size(), Interval());
+				std::uint32_t counter = 0;
+				// Iterative DFS: each stack entry is a type and the index of its next child to visit.
+				std::vector<std::pair<std::uint32_t, std::size_t>> stack;
+				for(std::uint32_t root : roots) {
+					intervals[root].pre = counter++;
+					stack.emplace_back(root, 0);
+					while(!stack.empty()) {
+						auto& [here, next] = stack.back();
+						if(next < children[here].size()) {
+							std::uint32_t child = children[here][next++];
+							intervals[child].pre = counter++;
+							stack.emplace_back(child, 0);
+						} else {
+							intervals[here].post = counter++;
+							stack.pop_back();
+						}
+					}
+				}
+			}
+
+			/// The type id of the type referring to objects of type `element`, or `noTypeId`.
+			std::uint32_t typeId(const std::type_info& element, bool handle) const {
+				auto it = ids[handle].find(element);
+				return it == ids[handle].end() ? noTypeId : it->second;
+			}
+
+			/// Whether type id `id` is in the forest, and so has an interval.
+			bool chained(std::uint32_t id) const {
+				return id < intervals.size() && intervals[id].pre != noTypeId;
+			}
+
+			/// The interval of type id `id`, which is `{noTypeId, noTypeId}` unless `TypeIntervals::chained`.
+			Interval interval(std::uint32_t id) const {
+				return id < intervals.size() ? intervals[id] : Interval();
+			}
+
+			/// Whether `ancestor` is `descendant` or one of its ancestors. Both must be `TypeIntervals::chained`.
+			bool contains(std::uint32_t ancestor, std::uint32_t descendant) const {
+				return intervals[ancestor].pre <= intervals[descendant].pre && intervals[descendant].post <= intervals[ancestor].post;
+			}
+		};
+	}
+}
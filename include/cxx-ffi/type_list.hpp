@@ -0,0 +1,185 @@
+#pragma once
+/************************************************************************************
+ * @file type_list.hpp
+ * A minimal variadic type-list engine, used in place of `boost::mpl` containers
+ * to keep the compile-time cost of #CXXFFI_EXPOSE manageable for large APIs.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <boost/mpl/fold.hpp>
+#include <boost/mpl/is_sequence.hpp>
+
+#include <type_traits>
+
+namespace CxxFFI {
+	/// A plain list of types. Used as both a sequence and (when free of duplicates) a set.
+	template<typename ...Ts> struct TypeList {
+		static constexpr std::size_t size = sizeof...(Ts); ///< The number of types in the list.
+	};
+
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/// Metafunction to concatenate any number of `TypeList`s.
+		template<typename ...Lists> struct ConcatImpl {
+			using type = TypeList<>; ///< Concatenation of zero lists.
+		};
+
+		/// Specialization of `ConcatImpl` for a single list.
+		template<typename ...Ts> struct ConcatImpl<TypeList<Ts...>> {
+			using type = TypeList<Ts...>; ///< Concatenation of one list.
+		};
+
+		/// Specialization of `ConcatImpl` which joins the first two lists, then recurses.
+		template<typename ...Ts, typename ...Us, typename ...Rest> struct ConcatImpl<TypeList<Ts...>, TypeList<Us...>, Rest...> {
+			using type = typename ConcatImpl<TypeList<Ts..., Us...>, Rest...>::type; ///< Concatenation of all the lists.
+		};
+	}
+
+	/// Concatenate any number of `TypeList`s.
+	template<typename ...Lists> using Concat = typename detail::ConcatImpl<Lists...>::type;
+
+	namespace detail {
+		/// Metafunction to prepend `T` to `List`.
+		template<typename List, typename T> struct PushFrontImpl;
+
+		/// Implementation of `PushFrontImpl`.
+		template<typename ...Ts, typename T> struct PushFrontImpl<TypeList<Ts...>, T> {
+			using type = TypeList<T, Ts...>; ///< `T` followed by `Ts...`.
+		};
+
+		/// Metafunction to obtain the first element of a non-empty `List`.
+		template<typename List> struct FrontImpl;
+
+		/// Implementation of `FrontImpl`.
+		template<typename T, typename ...Ts> struct FrontImpl<TypeList<T, Ts...>> {
+			using type = T; ///< The first element.
+		};
+
+		/// Metafunction to test whether `T` is an element of `List`.
+		template<typename List, typename T> struct ContainsImpl;
+
+		/// Implementation of `ContainsImpl` via a fold over `std::is_same_v`, which is a compiler builtin on modern toolchains.
+		template<typename ...Ts, typename T> struct ContainsImpl<TypeList<Ts...>, T> {
+			static constexpr bool value = (std::is_same_v<T, Ts> || ...); ///< Whether `T` appears in `Ts...`.
+		};
+	}
+
+	/// Prepend `T` to the `TypeList` `List`.
+	template<typename List, typename T> using PushFront = typename detail::PushFrontImpl<List, T>::type;
+
+	/// The first element of the non-empty `TypeList` `List`.
+	template<typename List> using Front = typename detail::FrontImpl<List>::type;
+
+	/// Whether `T` is an element of the `TypeList` `List`.
+	template<typename List, typename T> constexpr bool Contains = detail::ContainsImpl<List, T>::value;
+
+	/**************************************************
+	 * Insert `T` into the set `Set`, if not already
+	 * present. New elements are prepended, so that
+	 * iteration order matches that of `boost::mpl::set`.
+	 **************************************************/
+	template<typename Set, typename T> using Insert = std::conditional_t<Contains<Set, T>, Set, PushFront<Set, T>>;
+
+	namespace detail {
+		/// Metafunction to `Insert` each element of `List`, in order, into `Set`.
+		template<typename Set, typename List> struct InsertAllImpl;
+
+		/// Base case of `InsertAllImpl`, when `List` is exhausted.
+		template<typename Set> struct InsertAllImpl<Set, TypeList<>> {
+			using type = Set; ///< The accumulated set.
+		};
+
+		/// Recursive case of `InsertAllImpl`.
+		template<typename Set, typename Head, typename ...Tail> struct InsertAllImpl<Set, TypeList<Head, Tail...>> {
+			using type = typename InsertAllImpl<Insert<Set, Head>, TypeList<Tail...>>::type; ///< The accumulated set.
+		};
+
+		/// Metafunction keeping the elements `T` of `List` for which `Pred<T>::value` holds.
+		template<template<typename> class Pred, typename List> struct FilterImpl;
+
+		/// Implementation of `FilterImpl`.
+		template<template<typename> class Pred, typename ...Ts> struct FilterImpl<Pred, TypeList<Ts...>> {
+			using type = Concat<TypeList<>, std::conditional_t<Pred<Ts>::value, TypeList<Ts>, TypeList<>>...>; ///< The elements passing `Pred`, in order.
+		};
+
+		/// Metafunction mapping `F` over `List`.
+		template<template<typename> class F, typename List> struct TransformImpl;
+
+		/// Implementation of `TransformImpl`.
+		template<template<typename> class F, typename ...Ts> struct TransformImpl<F, TypeList<Ts...>> {
+			using type = TypeList<typename F<Ts>::type...>; ///< The results of `F`, in order.
+		};
+
+		/// Metafunction to insert every element of every list in `Lists` into `Set`.
+		template<typename Set, typename Lists> struct UnionAllImpl;
+
+		/// Implementation of `UnionAllImpl`.
+		template<typename Set, typename ...Lists> struct UnionAllImpl<Set, TypeList<Lists...>> {
+			using type = typename InsertAllImpl<Set, Concat<TypeList<>, Lists...>>::type; ///< The union of all the lists.
+		};
+
+		/// `boost::mpl`'s convention for metafunctions requires a wrapper struct, see `PushBackApplier::apply`.
+		struct PushBackApplier {
+			/// Append `T` to `List`.
+			template<typename List, typename T> struct apply;
+
+			/// Implementation of `PushBackApplier::apply`.
+			template<typename ...Ts, typename T> struct apply<TypeList<Ts...>, T> {
+				using type = TypeList<Ts..., T>; ///< `Ts...` followed by `T`.
+			};
+		};
+
+		/// Metafunction converting a `boost::mpl` sequence to a `TypeList`.
+		template<typename Seq, bool = boost::mpl::is_sequence<Seq>::value> struct AsTypeListImpl {
+			static_assert(boost::mpl::is_sequence<Seq>::value, "Expected a CxxFFI::TypeList or a boost::mpl sequence");
+		};
+
+		/// Specialization of `AsTypeListImpl` for `boost::mpl` sequences.
+		template<typename Seq> struct AsTypeListImpl<Seq, true> {
+			using type = typename boost::mpl::fold<Seq, TypeList<>, PushBackApplier>::type; ///< The elements of `Seq`, in order.
+		};
+
+		/// Specialization of `AsTypeListImpl` for `TypeList`s, which are already in the right form.
+		template<typename ...Ts> struct AsTypeListImpl<TypeList<Ts...>, false> {
+			using type = TypeList<Ts...>; ///< Identity.
+		};
+	}
+
+	/// `Insert` each element of `List`, in order, into `Set`. Equivalent to `boost::mpl::copy` with an `inserter`.
+	template<typename Set, typename List> using InsertAll = typename detail::InsertAllImpl<Set, List>::type;
+
+	/// Convert the `TypeList` `List` to a set, discarding duplicates.
+	template<typename List> using ToSet = InsertAll<TypeList<>, List>;
+
+	/// Take the union of the sets `Left` and `Right`.
+	template<typename Left, typename Right> using SetUnion = InsertAll<Left, Right>;
+
+	/// Take the union of every element of `Lists`, a `TypeList` of `TypeList`s.
+	template<typename Lists> using UnionAll = typename detail::UnionAllImpl<TypeList<>, Lists>::type;
+
+	/// Keep the elements `T` of `List` for which `Pred<T>::value` holds, preserving order.
+	template<template<typename> class Pred, typename List> using Filter = typename detail::FilterImpl<Pred, List>::type;
+
+	/// Map the metafunction `F` over `List`.
+	template<template<typename> class F, typename List> using Transform = typename detail::TransformImpl<F, List>::type;
+
+	/// Convert `Seq`, which may be a `TypeList` or any `boost::mpl` sequence, to a `TypeList`.
+	template<typename Seq> using AsTypeList = typename detail::AsTypeListImpl<Seq>::type;
+}
@@ -0,0 +1,150 @@
+#pragma once
+/************************************************************************************
+ * @file type_name.hpp
+ * Compile-time type names and hashes, obtained without RTTI or demangling.
+ *
+ * Copyright: Geopipe, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ************************************************************************************/
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace CxxFFI {
+	/**************************************************
+	 * Internal implementation details
+	 **************************************************/
+	namespace detail {
+		/**************************************************
+		 * The compiler's description of this function,
+		 * which names `T`. GCC produces
+		 * `... rawTypeName() [with T = X]`, and Clang
+		 * produces `... rawTypeName() [T = X]`.
+		 **************************************************/
+		template<typename T> constexpr const char* rawTypeName() {
+#if defined(__GNUC__) || defined(__clang__)
+			return __PRETTY_FUNCTION__;
+#else
+			return "";
+#endif
+		}
+
+		/// Extract the name of `T` from the result of `rawTypeName<T>()`, or an empty view on unsupported compilers.
+		constexpr std::string_view extractTypeName(std::string_view pretty) {
+			constexpr std::string_view marker = "T = ";
+			std::size_t start = pretty.find(marker);
+			std::size_t end = pretty.rfind(']');
+			if(start == std::string_view::npos || end == std::string_view::npos || end < start) {
+				return std::string_view();
+			} else {
+				start += marker.size();
+				return pretty.substr(start, end - start);
+			}
+		}
+
+		/// GCC's spelling of the anonymous namespace.
+		constexpr std::string_view gccAnonymousNamespace = "{anonymous}";
+		/// The spelling of the anonymous namespace produced by Clang and the Itanium demangler.
+		constexpr std::string_view demangledAnonymousNamespace = "(anonymous namespace)";
+
+		/// The length of `raw` after normalization by `normalizeTypeName`.
+		constexpr std::size_t normalizedTypeNameLength(std::string_view raw) {
+			std::size_t length = 0;
+			for(std::size_t i = 0; i < raw.size(); ) {
+				if(raw.substr(i, gccAnonymousNamespace.size()) == gccAnonymousNamespace) {
+					length += demangledAnonymousNamespace.size();
+					i += gccAnonymousNamespace.size();
+				} else {
+					++length;
+					++i;
+				}
+			}
+			return length;
+		}
+
+		/// Rewrite GCC's spellings in `raw` to match the Itanium demangler, producing a NUL-terminated array.
+		template<std::size_t N> constexpr std::array<char, N + 1> normalizeTypeName(std::string_view raw) {
+			std::array<char, N + 1> ans = {};
+			std::size_t out = 0;
+			for(std::size_t i = 0; i < raw.size(); ) {
+				if(raw.substr(i, gccAnonymousNamespace.size()) == gccAnonymousNamespace) {
+					for(char c : demangledAnonymousNamespace) {
+						ans[out++] = c;
+					}
+					i += gccAnonymousNamespace.size();
+				} else {
+					ans[out++] = raw[i++];
+				}
+			}
+			return ans;
+		}
+
+		/****************************************************************
+		 * Whether `name` consists only of (possibly namespace-qualified)
+		 * identifiers. Compilers render such names exactly as the Itanium
+		 * demangler would, but may differ in their rendering of template
+		 * arguments (e.g. default arguments), builtin types
+		 * (e.g. `long unsigned int`), and declarators.
+		 ****************************************************************/
+		constexpr bool isPlainTypeName(std::string_view name) {
+			if(name.empty()) {
+				return false;
+			}
+			for(std::size_t i = 0; i < name.size(); ++i) {
+				char c = name[i];
+				bool identifier = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == ':';
+				if(!identifier && name.substr(i, demangledAnonymousNamespace.size()) != demangledAnonymousNamespace) {
+					return false;
+				} else if(!identifier) {
+					i += demangledAnonymousNamespace.size() - 1;
+				}
+			}
+			return true;
+		}
+
+		/// 64-bit FNV-1a hash of `s`.
+		constexpr std::uint64_t fnv1a(std::string_view s) {
+			std::uint64_t hash = 0xcbf29ce484222325ull;
+			for(char c : s) {
+				hash = (hash ^ std::uint64_t(static_cast<unsigned char>(c))) * 0x100000001b3ull;
+			}
+			return hash;
+		}
+	}
+
+	/******************************************************
+	 * Compile-time name and hash of `T`, parsed from
+	 * `__PRETTY_FUNCTION__` and normalized to match the
+	 * Itanium demangler where GCC and Clang differ.
+	 * `TypeName<T>::value` is empty on unsupported compilers.
+	 ******************************************************/
+	template<typename T> struct TypeName {
+	private:
+		static constexpr std::string_view raw = detail::extractTypeName(detail::rawTypeName<T>()); ///< `T` as spelled by the compiler.
+		static constexpr std::size_t length = detail::normalizedTypeNameLength(raw); ///< Length of `TypeName::value`.
+		static constexpr std::array<char, length + 1> storage = detail::normalizeTypeName<length>(raw); ///< Backing storage for `TypeName::value`.
+	public:
+		static constexpr std::string_view value{storage.data(), length}; ///< The name of `T`.
+		static constexpr std::uint64_t hash = detail::fnv1a(value); ///< A stable hash of `TypeName::value`.
+		static constexpr bool plain = detail::isPlainTypeName(value); ///< Whether `TypeName::value` is identical to the demangled name of `T`. See `detail::isPlainTypeName`.
+	};
+
+	/// Compare the compile-time names of `T` and `U`.
+	template<typename T, typename U> constexpr bool sameTypeName() {
+		return TypeName<T>::hash == TypeName<U>::hash && TypeName<T>::value == TypeName<U>::value;
+	}
+}